@@ -48,6 +48,16 @@ class PClassAmmo;
 struct FBlockNode;
 struct FPortalGroupArray;
 
+// Per-iterator visit stamps used by the blockmap iterators in p_maputl.cpp.
+// Every iterator that is alive at the same time owns a different slot, so
+// nested iterations do not disturb each other the way validcount does.
+enum { NUM_BLOCKITERATOR_SLOTS = 4 };
+
+struct FBlockIteratorStamps
+{
+	unsigned Stamp[NUM_BLOCKITERATOR_SLOTS];
+};
+
 //
 // NOTES: AActor
 //
@@ -1152,6 +1162,7 @@ public:
 	struct portnode_t	*render_portallist;		// and for cross-lineportal
 	struct msecnode_t	*touching_rendersectors; // this is the list of sectors that this thing interesects with it's max(radius, renderradius).
 	int validcount;
+	FBlockIteratorStamps BlockIterStamps;	// for FBlockThingsIterator
 
 
 	TObjPtr<AInventory>	Inventory;		// [RH] This actor's inventory
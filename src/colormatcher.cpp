@@ -34,7 +34,15 @@
 ** It was, but the results were not as good as I would like, so I didn't
 ** actually use it. But I did keep the code around in case I ever felt like
 ** revisiting the problem. I never did, so now it's relegated to the mists
-** of SVN history, and this is just a thin wrapper around BestColor().
+** of SVN history.
+**
+** This time around, it returns exactly what BestColor() would. The RGB
+** cube is split into 16x16x16 cells, and for each cell it remembers which
+** palette entries could possibly be the closest match for any color inside
+** it. A palette entry whose nearest point in the cell is farther away than
+** some other entry's farthest point can never win, so it is left out.
+** That usually leaves only a handful to be searched for each Pick() call.
+** Cells are built the first time something is picked from them.
 **
 */
 
@@ -42,6 +50,7 @@
 #include <string.h>
 
 #include "doomtype.h"
+#include "templates.h"
 #include "colormatcher.h"
 #include "v_palette.h"
 
@@ -63,18 +72,147 @@ FColorMatcher::FColorMatcher (const FColorMatcher &other)
 FColorMatcher &FColorMatcher::operator= (const FColorMatcher &other)
 {
 	Pal = other.Pal;
+	CellStart = other.CellStart;
+	Candidates = other.Candidates;
 	return *this;
 }
 
 void FColorMatcher::SetPalette (const DWORD *palette)
 {
 	Pal = (const PalEntry *)palette;
+	CellStart.Resize(NUM_CELLS);
+	memset(&CellStart[0], 0, NUM_CELLS * sizeof(CellStart[0]));
+	Candidates.Clear();
+	Candidates.Push(0);		// so that no cell starts at 0
+}
+
+//==========================================================================
+//
+// Squared distances from a palette component to the nearest and farthest
+// point of a cell along one axis.
+//
+//==========================================================================
+
+static inline int AxisMinDist (int p, int lo, int hi)
+{
+	int d = p < lo ? lo - p : p > hi ? p - hi : 0;
+	return d * d;
+}
+
+static inline int AxisMaxDist (int p, int lo, int hi)
+{
+	int d = MAX(p - lo, hi - p);
+	return d * d;
 }
 
+//==========================================================================
+//
+// FColorMatcher :: BuildCell
+//
+// Uses the same range of palette entries as BestColor's defaults.
+//
+//==========================================================================
+
+const BYTE *FColorMatcher::BuildCell (int cell)
+{
+	int rlo = ((cell >> (CELL_BITS * 2)) & CELL_MASK) << CELL_SHIFT;
+	int glo = ((cell >> CELL_BITS) & CELL_MASK) << CELL_SHIFT;
+	int blo = (cell & CELL_MASK) << CELL_SHIFT;
+	int rhi = rlo + (1 << CELL_SHIFT) - 1;
+	int ghi = glo + (1 << CELL_SHIFT) - 1;
+	int bhi = blo + (1 << CELL_SHIFT) - 1;
+	int mindist[256];
+	int bound = INT_MAX;
+
+	for (int i = 1; i < 255; ++i)
+	{
+		mindist[i] = AxisMinDist(Pal[i].r, rlo, rhi) + AxisMinDist(Pal[i].g, glo, ghi) + AxisMinDist(Pal[i].b, blo, bhi);
+		int maxdist = AxisMaxDist(Pal[i].r, rlo, rhi) + AxisMaxDist(Pal[i].g, glo, ghi) + AxisMaxDist(Pal[i].b, blo, bhi);
+		if (maxdist < bound)
+		{
+			bound = maxdist;
+		}
+	}
+
+	// Entries are kept in palette order so that ties go to the same
+	// entry as in BestColor().
+	unsigned start = Candidates.Size();
+	Candidates.Push(0);
+	for (int i = 1; i < 255; ++i)
+	{
+		if (mindist[i] <= bound)
+		{
+			Candidates.Push(i);
+		}
+	}
+	Candidates[start] = BYTE(Candidates.Size() - start - 1);
+	CellStart[cell] = start;
+	return &Candidates[start];
+}
+
+//==========================================================================
+//
+// FColorMatcher :: Pick
+//
+//==========================================================================
+
 BYTE FColorMatcher::Pick (int r, int g, int b)
 {
 	if (Pal == NULL)
 		return 1;
 
-	return (BYTE)BestColor ((uint32 *)Pal, r, g, b);
+	if ((r | g | b) & ~255)
+	{ // Outside the cube
+		return (BYTE)BestColor ((uint32 *)Pal, r, g, b);
+	}
+
+	int cell = ((r >> CELL_SHIFT) << (CELL_BITS * 2)) | ((g >> CELL_SHIFT) << CELL_BITS) | (b >> CELL_SHIFT);
+	const BYTE *cand = CellStart[cell] != 0 ? &Candidates[CellStart[cell]] : BuildCell(cell);
+	int count = *cand++;
+	int bestcolor = cand[0];
+	int bestdist = INT_MAX;
+
+	for (int i = 0; i < count; ++i)
+	{
+		const PalEntry &pe = Pal[cand[i]];
+		int x = r - pe.r;
+		int y = g - pe.g;
+		int z = b - pe.b;
+		int dist = x*x + y*y + z*z;
+		if (dist < bestdist)
+		{
+			if (dist == 0)
+				return cand[i];
+
+			bestdist = dist;
+			bestcolor = cand[i];
+		}
+	}
+	return (BYTE)bestcolor;
+}
+
+//==========================================================================
+//
+// FColorMatcher :: PickMany
+//
+// Picks a whole run of colors. Runs of the same color are only looked up
+// once.
+//
+//==========================================================================
+
+void FColorMatcher::PickMany (BYTE *out, const PalEntry *colors, int count)
+{
+	uint32 lastcolor = 0;
+	BYTE lastpick = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		uint32 color = colors[i].d & 0xFFFFFF;
+		if (i == 0 || color != lastcolor)
+		{
+			lastcolor = color;
+			lastpick = Pick(colors[i].r, colors[i].g, colors[i].b);
+		}
+		out[i] = lastpick;
+	}
 }
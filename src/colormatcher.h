@@ -47,11 +47,28 @@ public:
 	{
 		return Pick(pe.r, pe.g, pe.b);
 	}
+	void PickMany (BYTE *out, const PalEntry *colors, int count);
 
 	FColorMatcher &operator= (const FColorMatcher &other);
 
 private:
+	enum
+	{
+		CELL_BITS = 4,
+		CELL_SHIFT = 8 - CELL_BITS,
+		CELL_MASK = (1 << CELL_BITS) - 1,
+		NUM_CELLS = 1 << (CELL_BITS * 3)
+	};
+
 	const PalEntry *Pal;
+
+	// For every cell of the RGB cube, the offset in Candidates where the
+	// palette entries that can be closest to something inside that cell
+	// are listed, preceded by their count. 0 if not built yet.
+	TArray<unsigned> CellStart;
+	TArray<BYTE> Candidates;
+
+	const BYTE *BuildCell (int cell);
 };
 
 extern FColorMatcher ColorMatcher;
@@ -75,6 +75,7 @@ typedef enum
 	ga_screenshot,
 	ga_togglemap,
 	ga_fullconsole,
+	ga_demoseek,
 } gameaction_t;
 
 
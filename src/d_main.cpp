@@ -958,6 +958,39 @@ void D_ErrorCleanup ()
 	Renderer->ErrorCleanup();
 }
 
+//==========================================================================
+//
+// D_RunDemoTics
+//
+// Runs tics of a playing demo back to back without displaying them, for
+// seeking and turbo playback. Gives up after a while so that the screen
+// and input still get updated during long seeks.
+//
+//==========================================================================
+
+static void D_RunDemoTics (int count)
+{
+	DWORD start = I_MSTime ();
+
+	while (count-- > 0 && demoplayback && gameaction == ga_nothing)
+	{
+		G_BuildTiccmd (&netcmds[consoleplayer][maketic%BACKUPTICS]);
+		C_Ticker ();
+		M_Ticker ();
+		G_Ticker ();
+		gametic++;
+		maketic++;
+		GC::CheckGC ();
+		Net_NewMakeTic ();
+		if (I_MSTime () - start >= 100)
+		{
+			break;
+		}
+	}
+	// [RH] Use the consoleplayer's camera to update sounds
+	S_UpdateSounds (players[consoleplayer].camera);	// move positional sounds
+}
+
 //==========================================================================
 //
 // D_DoomLoop
@@ -1008,7 +1041,12 @@ void D_DoomLoop ()
 			}
 			else
 			{
+				int startgametic = gametic;
 				TryRunTics (); // will run at least one tic
+				if (demoplayback)
+				{
+					D_RunDemoTics (G_DemoTicsToRun (gametic - startgametic));
+				}
 			}
 			// Update display, next frame, with current state.
 			I_StartTic ();
@@ -167,6 +167,10 @@ CUSTOM_CVAR(Int, net_extratic, 0, CVAR_SERVERINFO | CVAR_NOSAVE)
 	}
 }
 
+// How packets are compressed. Only the host's setting matters, and it is
+// sent to everybody else when the game starts.
+CVAR(Int, net_compression, NETCOMPRESS_FAST, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 #ifdef _DEBUG
 CVAR(Int, net_fakelatency, 0, 0);
 
@@ -1388,7 +1392,8 @@ void NetUpdate (void)
 //  0 One byte set to NCMD_SETUP+2
 //  1 One byte for ticdup setting
 //  2 One byte for NetMode setting
-//  3 String with starting map's name
+//  3 One byte for packet compression (see I_SetNetCompression)
+//  4 String with starting map's name
 //  . Four bytes for the RNG seed
 //  . Stream containing remaining game info
 //
@@ -1470,8 +1475,9 @@ bool DoArbitrate (void *userdata)
 
 			ticdup = doomcom.ticdup = netbuffer[1];
 			NetMode = netbuffer[2];
+			I_SetNetCompression (netbuffer[3]);
 
-			stream = &netbuffer[3];
+			stream = &netbuffer[4];
 			s = ReadString (&stream);
 			startmap = s;
 			delete[] s;
@@ -1537,7 +1543,8 @@ bool DoArbitrate (void *userdata)
 		netbuffer[0] = NCMD_SETUP+2;
 		netbuffer[1] = (BYTE)doomcom.ticdup;
 		netbuffer[2] = NetMode;
-		stream = &netbuffer[3];
+		netbuffer[3] = (BYTE)clamp<int> (net_compression, NETCOMPRESS_NONE, NETCOMPRESS_BEST);
+		stream = &netbuffer[4];
 		WriteString (startmap, &stream);
 		WriteLong (rngseed, &stream);
 		C_WriteCVars (&stream, CVAR_SERVERINFO, true);
@@ -1617,6 +1624,7 @@ void D_ArbitrateNetStart (void)
 	{
 		netbuffer[0] = NCMD_SETUP+3;
 		SendSetup (data.playersdetected, data.gotsetup, 1);
+		I_SetNetCompression (net_compression);
 	}
 
 	if (debugfile)
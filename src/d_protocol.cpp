@@ -34,6 +34,7 @@
 
 #include "i_system.h"
 #include "d_ticcmd.h"
+#include "d_event.h"
 #include "d_net.h"
 #include "doomdef.h"
 #include "doomstat.h"
@@ -351,6 +352,64 @@ int WriteUserCmdMessage (usercmd_t *ucmd, const usercmd_t *basis, BYTE **stream)
 	return 1;
 }
 
+//==========================================================================
+//
+// MakeUserCmdDictionary
+//
+// Builds the preset dictionary for network packet compression from the
+// kind of ticcmds that make up most of a game: standing, walking and
+// running in all directions while turning, shooting and using things.
+// All nodes build the same dictionary, since NETGAMEVERSION must match.
+//
+//==========================================================================
+
+void MakeUserCmdDictionary (TArray<BYTE> &dict)
+{
+	static const short moves[][2] =
+	{
+		{ 0, 0 },
+		{ 0x1900, 0 }, { 0x3200, 0 }, { -0x1900, 0 }, { -0x3200, 0 },
+		{ 0, 0x1800 }, { 0, 0x2800 }, { 0, -0x1800 }, { 0, -0x2800 },
+		{ 0x3200, 0x2800 }, { 0x3200, -0x2800 },
+	};
+	static const DWORD buttons[] = { 0, BT_ATTACK, BT_SPEED, BT_ATTACK|BT_SPEED, BT_USE };
+	static const short turns[] = { 0, 0x100, -0x100 };
+
+	BYTE buffer[32];
+	usercmd_t basis, cmd;
+
+	memset (&basis, 0, sizeof(basis));
+	dict.Clear();
+	for (auto turn : turns)
+	{
+		for (auto &move : moves)
+		{
+			for (auto button : buttons)
+			{
+				cmd = basis;
+				cmd.buttons = button;
+				cmd.yaw = turn;
+				cmd.forwardmove = move[0];
+				cmd.sidemove = move[1];
+
+				BYTE *stream = buffer;
+				WriteUserCmdMessage (&cmd, &basis, &stream);
+				for (BYTE *p = buffer; p < stream; ++p)
+				{
+					dict.Push(*p);
+				}
+				basis = cmd;
+			}
+		}
+	}
+	// Most tics are the same as the one before them. Put those last, since
+	// the closest matches are the cheapest.
+	for (int i = 0; i < 32; ++i)
+	{
+		dict.Push(DEM_EMPTYUSERCMD);
+	}
+}
+
 
 int SkipTicCmd (BYTE **stream, int count)
 {
@@ -226,6 +226,7 @@ void SkipChunk (BYTE **stream);
 int UnpackUserCmd (usercmd_t *ucmd, const usercmd_t *basis, BYTE **stream);
 int PackUserCmd (const usercmd_t *ucmd, const usercmd_t *basis, BYTE **stream);
 int WriteUserCmdMessage (usercmd_t *ucmd, const usercmd_t *basis, BYTE **stream);
+void MakeUserCmdDictionary (TArray<BYTE> &dict);
 
 struct ticcmd_t;
 
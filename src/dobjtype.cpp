@@ -72,6 +72,7 @@ FTypeTable TypeTable;
 PSymbolTable GlobalSymbols;
 TArray<PClass *> PClass::AllClasses;
 bool PClass::bShutdown;
+unsigned PClass::VirtualGeneration = 1;
 
 PErrorType *TypeError;
 PErrorType *TypeAuto;
@@ -2904,6 +2905,7 @@ void PClass::StaticShutdown ()
 	}
 	TypeTable.Clear();
 	bShutdown = true;
+	VirtualGeneration++;
 
 	AllClasses.Clear();
 	PClassActor::AllActorClasses.Clear();
@@ -3324,6 +3326,7 @@ PClass *PClass::CreateDerivedClass(FName name, unsigned int size)
 	{
 		type->InitializeDefaults();
 		type->Virtuals = Virtuals;
+		VirtualGeneration++;
 		DeriveData(type);
 	}
 	if (!notnew)
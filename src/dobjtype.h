@@ -865,6 +865,7 @@ public:
 	static TArray<PClass *> AllClasses;
 
 	static bool bShutdown;
+	static unsigned VirtualGeneration;	// changes whenever a virtual table may have changed
 };
 
 class PClassType : public PClass
@@ -309,7 +309,7 @@ DEFINE_ACTION_FUNCTION(DThinker, PostBeginPlay)
 
 void DThinker::CallPostBeginPlay()
 {
-	IFVIRTUAL(DThinker, PostBeginPlay)
+	IFOVERRIDENVIRTUAL(DThinker, PostBeginPlay)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[1] = { (DObject*)this };
@@ -552,7 +552,7 @@ DEFINE_ACTION_FUNCTION(DThinker, Tick)
 
 void DThinker::CallTick()
 {
-	IFVIRTUAL(DThinker, Tick)
+	IFOVERRIDENVIRTUAL(DThinker, Tick)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[1] = { (DObject*)this };
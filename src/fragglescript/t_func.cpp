@@ -3888,7 +3888,7 @@ void FParser::SF_SetColor(void)
 		FSSectorTagIterator itr(tagnum);
 		while ((i = itr.Next()) >= 0)
 		{
-			sectors[i].ColorMap = GetSpecialLights (color, sectors[i].ColorMap->Fade, 0);
+			sectors[i].ColorMap = GetSpecialLights (color, sectors[i].ColorMap->Fade, 0, true);
 		}
 	}
 }
@@ -100,6 +100,8 @@ const int SAVEPICWIDTH = 216;
 const int SAVEPICHEIGHT = 162;
 
 bool	G_CheckDemoStatus (void);
+static void G_DemoKeyframeTicker ();
+static void	G_DoDemoSeek ();
 void	G_ReadDemoTiccmd (ticcmd_t *cmd, int player);
 void	G_WriteDemoTiccmd (ticcmd_t *cmd, int player, int buf);
 void	G_PlayerReborn (int player);
@@ -187,6 +189,8 @@ size_t			maxdemosize;
 BYTE*			zdemformend;			// end of FORM ZDEM chunk
 BYTE*			zdembodyend;			// end of ZDEM BODY chunk
 bool 			singledemo; 			// quit after playing a demo from cmdline 
+static int		DemoTic;				// tics played since the demo started
+static int		DemoSeekTic = -1;		// tic being seeked to, or -1
  
 bool 			precache = true;		// if true, load all graphics at start 
  
@@ -1042,6 +1046,8 @@ void G_Ticker ()
 		}
 	}
 
+	M_FinishScreenShots ();
+
 	if (ToggleFullscreen)
 	{
 		static char toggle_fullscreen[] = "toggle fullscreen";
@@ -1114,6 +1120,9 @@ void G_Ticker ()
 			AM_ToggleMap ();
 			gameaction = ga_nothing;
 			break;
+		case ga_demoseek:
+			G_DoDemoSeek ();
+			break;
 		case ga_nothing:
 			break;
 		}
@@ -1140,6 +1149,11 @@ void G_Ticker ()
 	// check, not just the player's x position like BOOM.
 	DWORD rngsum = FRandom::StaticSumSeeds ();
 
+	if (demoplayback)
+	{
+		G_DemoKeyframeTicker ();
+	}
+
 	//Added by MC: For some of that bot stuff. The main bot function.
 	bglobal.Main ();
 
@@ -1199,6 +1213,11 @@ void G_Ticker ()
 		}
 	}
 
+	if (demoplayback)
+	{
+		DemoTic++;
+	}
+
 	// do main actions
 	switch (gamestate)
 	{
@@ -1879,6 +1898,96 @@ bool G_CheckSaveGameWads (FSerializer &arc, bool printwarn)
 }
 
 
+//==========================================================================
+//
+// G_ReadGameGlobals
+//
+// Restores everything that is not part of a level snapshot and loads the
+// given map from its snapshot. The snapshots must already be in place.
+//
+//==========================================================================
+
+static void G_ReadGameGlobals(FSerializer &arc, const char *map)
+{
+	// Read intermission data for hubs
+	G_SerializeHub(arc);
+
+	bglobal.RemoveAllBots(true);
+
+	FString cvar;
+	arc("importantcvars", cvar);
+	if (!cvar.IsEmpty())
+	{
+		BYTE *vars_p = (BYTE *)cvar.GetChars();
+		C_ReadCVars(&vars_p);
+	}
+
+	DWORD time[2] = { 1,0 };
+
+	arc("ticrate", time[0])
+		("leveltime", time[1]);
+	// dearchive all the modifications
+	level.time = Scale(time[1], TICRATE, time[0]);
+
+	G_ReadVisited(arc);
+
+	// load a base level
+	savegamerestore = true;		// Use the player actors in the savegame
+	bool demoplaybacksave = demoplayback;
+	G_InitNew(map, false);
+	demoplayback = demoplaybacksave;
+	savegamerestore = false;
+
+	STAT_Serialize(arc);
+	FRandom::StaticReadRNGState(arc);
+	P_ReadACSDefereds(arc);
+	P_ReadACSVars(arc);
+
+	NextSkill = -1;
+	arc("nextskill", NextSkill);
+
+	if (level.info != nullptr)
+		level.info->Snapshot.Clean();
+}
+
+//==========================================================================
+//
+// G_WriteGameGlobals
+//
+// Counterpart to G_ReadGameGlobals.
+//
+//==========================================================================
+
+static void G_WriteGameGlobals(FSerializer &arc)
+{
+	// Intermission stats for hubs
+	G_SerializeHub(arc);
+
+	{
+		FString vars = C_GetMassCVarString(CVAR_SERVERINFO);
+		arc.AddString("importantcvars", vars.GetChars());
+	}
+
+	if (level.time != 0 || level.maptime != 0)
+	{
+		int tic = TICRATE;
+		arc("ticrate", tic);
+		arc("leveltime", level.time);
+	}
+
+	STAT_Serialize(arc);
+	FRandom::StaticWriteRNGState(arc);
+	P_WriteACSDefereds(arc);
+	P_WriteACSVars(arc);
+	G_WriteVisited(arc);
+
+
+	if (NextSkill != -1)
+	{
+		arc("nextskill", NextSkill);
+	}
+}
+
 void G_DoLoadGame ()
 {
 	bool hidecon;
@@ -1996,48 +2105,11 @@ void G_DoLoadGame ()
 		}
 
 
-		// Read intermission data for hubs
-		G_SerializeHub(arc);
-
-		bglobal.RemoveAllBots(true);
-
-		FString cvar;
-		arc("importantcvars", cvar);
-		if (!cvar.IsEmpty())
-		{
-			BYTE *vars_p = (BYTE *)cvar.GetChars();
-			C_ReadCVars(&vars_p);
-		}
-
-		DWORD time[2] = { 1,0 };
-
-		arc("ticrate", time[0])
-			("leveltime", time[1]);
-		// dearchive all the modifications
-		level.time = Scale(time[1], TICRATE, time[0]);
-
 		G_ReadSnapshots(resfile);
 		delete resfile;	// we no longer need the resource file below this point
 		resfile = nullptr;
-		G_ReadVisited(arc);
-
-		// load a base level
-		savegamerestore = true;		// Use the player actors in the savegame
-		bool demoplaybacksave = demoplayback;
-		G_InitNew(map, false);
-		demoplayback = demoplaybacksave;
-		savegamerestore = false;
-
-		STAT_Serialize(arc);
-		FRandom::StaticReadRNGState(arc);
-		P_ReadACSDefereds(arc);
-		P_ReadACSVars(arc);
 
-		NextSkill = -1;
-		arc("nextskill", NextSkill);
-
-		if (level.info != nullptr)
-			level.info->Snapshot.Clean();
+		G_ReadGameGlobals(arc, map);
 
 		BackupSaveName = savename;
 
@@ -2284,32 +2356,7 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 	PutSaveWads (savegameinfo);
 	PutSaveComment (savegameinfo);
 
-	// Intermission stats for hubs
-	G_SerializeHub(savegameglobals);
-
-	{
-		FString vars = C_GetMassCVarString(CVAR_SERVERINFO);
-		savegameglobals.AddString("importantcvars", vars.GetChars());
-	}
-
-	if (level.time != 0 || level.maptime != 0)
-	{
-		int tic = TICRATE;
-		savegameglobals("ticrate", tic);
-		savegameglobals("leveltime", level.time);
-	}
-
-	STAT_Serialize(savegameglobals);
-	FRandom::StaticWriteRNGState(savegameglobals);
-	P_WriteACSDefereds(savegameglobals);
-	P_WriteACSVars(savegameglobals);
-	G_WriteVisited(savegameglobals);
-
-
-	if (NextSkill != -1)
-	{
-		savegameglobals("nextskill", NextSkill);
-	}
+	G_WriteGameGlobals(savegameglobals);
 
 	auto picdata = savepic.GetBuffer();
 	FCompressedBuffer bufpng = { picdata->Size(), picdata->Size(), METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->Size())), (char*)&(*picdata)[0] };
@@ -2407,6 +2454,234 @@ void G_ReadDemoTiccmd (ticcmd_t *cmd, int player)
 	}
 } 
 
+//==========================================================================
+//
+// Demo keyframes
+//
+// While a demo plays, the game state is kept in memory every
+// demo_keyframeinterval seconds, the same way a savegame would store it.
+// demoseek restores the closest keyframe before the requested time and
+// then runs the remaining tics without rendering them. Once there are
+// more than demo_maxkeyframes, every other one is dropped, so long demos
+// keep keyframes over their whole length, only further apart.
+//
+//==========================================================================
+
+CUSTOM_CVAR(Int, demo_keyframeinterval, 30, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+}
+CUSTOM_CVAR(Int, demo_maxkeyframes, 64, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 2) self = 2;
+}
+CUSTOM_CVAR(Int, demo_turbo, 1, 0)
+{
+	if (self < 1) self = 1;
+	else if (self > 64) self = 64;
+}
+
+struct FDemoKeyframe
+{
+	int Tic;
+	ptrdiff_t DemoPos;
+	FString MapName;
+	bool InGame[MAXPLAYERS];
+	usercmd_t Cmds[MAXPLAYERS];
+	TArray<level_info_t *> SnapshotInfos;
+	TArray<FCompressedBuffer> Snapshots;
+	FCompressedBuffer Globals;
+
+	void Clean()
+	{
+		for (auto &snap : Snapshots)
+		{
+			snap.Clean();
+		}
+		Globals.Clean();
+	}
+};
+
+static TArray<FDemoKeyframe> DemoKeyframes;
+
+static void G_ClearDemoKeyframes()
+{
+	for (auto &key : DemoKeyframes)
+	{
+		key.Clean();
+	}
+	DemoKeyframes.Clear();
+	DemoTic = 0;
+	DemoSeekTic = -1;
+}
+
+static void G_CaptureDemoKeyframe()
+{
+	FDemoKeyframe key;
+	FSerializer arc;
+
+	G_SnapshotLevel();
+	arc.OpenWriter(false);
+	G_WriteGameGlobals(arc);
+
+	key.Tic = DemoTic;
+	key.DemoPos = demo_p - demobuffer;
+	key.MapName = level.MapName;
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		key.InGame[i] = playeringame[i];
+		key.Cmds[i] = players[i].cmd.ucmd;
+	}
+	G_CopySnapshots(key.SnapshotInfos, key.Snapshots);
+	key.Globals = arc.GetCompressedOutput();
+	DemoKeyframes.Push(key);
+
+	if (DemoKeyframes.Size() > (unsigned)demo_maxkeyframes)
+	{
+		// Keep the first one so that the demo's start can always be reached.
+		for (int i = DemoKeyframes.Size() - 1; i > 0; i--)
+		{
+			if (i & 1)
+			{
+				DemoKeyframes[i].Clean();
+				DemoKeyframes.Delete(i);
+			}
+		}
+	}
+
+	// The copies hold everything now.
+	level.info->Snapshot.Clean();
+}
+
+static void G_RestoreDemoKeyframe(FDemoKeyframe &key)
+{
+	FSerializer arc;
+
+	if (!arc.OpenReader(&key.Globals))
+	{
+		Printf("Failed to restore demo keyframe\n");
+		return;
+	}
+	G_RestoreSnapshots(key.SnapshotInfos, key.Snapshots);
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		playeringame[i] = key.InGame[i];
+	}
+	G_ReadGameGlobals(arc, key.MapName);
+	usergame = false;	// G_InitNew sets this, but this is still a demo
+
+	// Demo ticcmds are delta compressed against the previous ones.
+	for (int i = 0; i < MAXPLAYERS; i++)
+	{
+		players[i].cmd.ucmd = key.Cmds[i];
+	}
+	demo_p = demobuffer + key.DemoPos;
+	DemoTic = key.Tic;
+}
+
+//==========================================================================
+//
+// G_DemoKeyframeTicker
+//
+// Called once per tic before the demo's ticcmds are read.
+//
+//==========================================================================
+
+static void G_DemoKeyframeTicker()
+{
+	if (demo_keyframeinterval > 0 && gamestate == GS_LEVEL && DemoTic % (demo_keyframeinterval * TICRATE) == 0 &&
+		(DemoKeyframes.Size() == 0 || DemoKeyframes.Last().Tic < DemoTic))
+	{
+		G_CaptureDemoKeyframe();
+	}
+}
+
+//==========================================================================
+//
+// G_DoDemoSeek
+//
+// Only goes back to a keyframe if the target is behind the current
+// position or the keyframe is closer to it than the current position.
+// Everything else is left to fast forwarding.
+//
+//==========================================================================
+
+static void G_DoDemoSeek()
+{
+	gameaction = ga_nothing;
+	if (!demoplayback || DemoSeekTic < 0)
+	{
+		return;
+	}
+
+	FDemoKeyframe *key = nullptr;
+	for (auto &k : DemoKeyframes)
+	{
+		if (k.Tic > DemoSeekTic) break;
+		key = &k;
+	}
+	if (DemoSeekTic < DemoTic || (key != nullptr && key->Tic > DemoTic))
+	{
+		if (key == nullptr)
+		{
+			Printf("No keyframe before %d:%02d\n", DemoSeekTic / TICRATE / 60, DemoSeekTic / TICRATE % 60);
+			DemoSeekTic = -1;
+			return;
+		}
+		G_RestoreDemoKeyframe(*key);
+	}
+}
+
+//==========================================================================
+//
+// G_DemoTicsToRun
+//
+// Returns how many tics the main loop should run on top of the ones it
+// just ran without displaying them, either to reach a seek target or for
+// turbo playback.
+//
+//==========================================================================
+
+int G_DemoTicsToRun(int ticsrun)
+{
+	if (!demoplayback || gameaction != ga_nothing)
+	{
+		return 0;
+	}
+	if (DemoSeekTic >= 0)
+	{
+		if (DemoTic < DemoSeekTic)
+		{
+			return DemoSeekTic - DemoTic;
+		}
+		DemoSeekTic = -1;
+		return 0;
+	}
+	return ticsrun * (demo_turbo - 1);
+}
+
+CCMD(demoseek)
+{
+	if (!demoplayback)
+	{
+		Printf("Not playing a demo\n");
+		return;
+	}
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: demoseek [+|-]<seconds>\n");
+		Printf("At %d:%02d, %u keyframes\n", DemoTic / TICRATE / 60, DemoTic / TICRATE % 60, DemoKeyframes.Size());
+		return;
+	}
+	int tics = int(atof(argv[1]) * TICRATE);
+	if (argv[1][0] == '+' || argv[1][0] == '-')
+	{
+		tics += DemoTic;
+	}
+	DemoSeekTic = MAX(tics, 0);
+	gameaction = ga_demoseek;
+}
+
 bool stoprecording;
 
 CCMD (stop)
@@ -2811,6 +3086,7 @@ void G_DoPlayDemo (void)
 
 		usergame = false;
 		demoplayback = true;
+		G_ClearDemoKeyframes ();
 	}
 }
 
@@ -2857,6 +3133,7 @@ bool G_CheckDemoStatus (void)
 		C_RestoreCVars ();		// [RH] Restore cvars demo might have changed
 		M_Free (demobuffer);
 		demobuffer = NULL;
+		G_ClearDemoKeyframes ();
 
 		P_SetupWeapons_ntohton();
 		demoplayback = false;
@@ -57,6 +57,7 @@ void G_BeginRecording (const char *startmap);
 void G_PlayDemo (char* name);
 void G_TimeDemo (const char* name);
 bool G_CheckDemoStatus (void);
+int G_DemoTicsToRun (int ticsrun);
 
 void G_WorldDone (void);
 
@@ -356,7 +356,7 @@ DEFINE_ACTION_FUNCTION(AInventory, DoEffect)
 
 void AInventory::CallDoEffect()
 {
-	IFVIRTUAL(AInventory, DoEffect)
+	IFOVERRIDENVIRTUAL(AInventory, DoEffect)
 	{
 		VMValue params[1] = { (DObject*)this };
 		VMFrameStack stack;
@@ -547,7 +547,7 @@ DEFINE_ACTION_FUNCTION(AInventory, CreateCopy)
 
 AInventory *AInventory::CallCreateCopy(AActor *other)
 {
-	IFVIRTUAL(AInventory, CreateCopy)
+	IFOVERRIDENVIRTUAL(AInventory, CreateCopy)
 	{
 		VMValue params[2] = { (DObject*)this, (DObject*)other };
 		VMReturn ret;
@@ -818,7 +818,7 @@ DEFINE_ACTION_FUNCTION(AInventory, Use)
 
 bool AInventory::CallUse(bool pickup)
 {
-	IFVIRTUAL(AInventory, Use)
+	IFOVERRIDENVIRTUAL(AInventory, Use)
 	{
 		VMValue params[2] = { (DObject*)this, pickup };
 		VMReturn ret;
@@ -1639,7 +1639,7 @@ DEFINE_ACTION_FUNCTION(AInventory, AttachToOwner)
 
 void AInventory::CallAttachToOwner(AActor *other)
 {
-	IFVIRTUAL(AInventory, AttachToOwner)
+	IFOVERRIDENVIRTUAL(AInventory, AttachToOwner)
 	{
 		VMValue params[2] = { (DObject*)this, (DObject*)other };
 		GlobalVMStack.Call(func, params, 2, nullptr, 0, nullptr);
@@ -1670,7 +1670,7 @@ DEFINE_ACTION_FUNCTION(AInventory, DetachFromOwner)
 
 void AInventory::CallDetachFromOwner()
 {
-	IFVIRTUAL(AInventory, DetachFromOwner)
+	IFOVERRIDENVIRTUAL(AInventory, DetachFromOwner)
 	{
 		VMValue params[1] = { (DObject*)this };
 		GlobalVMStack.Call(func, params, 1, nullptr, 0, nullptr);
@@ -826,7 +826,7 @@ DEFINE_ACTION_FUNCTION(AWeapon, EndPowerup)
 
 void AWeapon::CallEndPowerup()
 {
-	IFVIRTUAL(AWeapon, EndPowerup)
+	IFOVERRIDENVIRTUAL(AWeapon, EndPowerup)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[1] = { (DObject*)this };
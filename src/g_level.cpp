@@ -884,6 +884,9 @@ void G_DoCompleted (void)
 	viewactive = false;
 	automapactive = false;
 
+	// Read the next map's lumps from disk while the intermission is up.
+	P_PrefetchMapLumps (nextlevel);
+
 // [RH] If you ever get a statistics driver operational, adapt this.
 //	if (statcopy)
 //		memcpy (statcopy, &wminfo, sizeof(wminfo));
@@ -1618,6 +1621,59 @@ void G_WriteSnapshots(TArray<FString> &filenames, TArray<FCompressedBuffer> &buf
 	}
 }
 
+//==========================================================================
+//
+// G_CopySnapshots
+//
+// Makes private copies of all level snapshots so that a game state can be
+// kept in memory without going through a savegame file.
+//
+//==========================================================================
+
+static FCompressedBuffer CopySnapshot(const FCompressedBuffer &src)
+{
+	FCompressedBuffer copy = src;
+	copy.mBuffer = new char[src.mCompressedSize];
+	memcpy(copy.mBuffer, src.mBuffer, src.mCompressedSize);
+	return copy;
+}
+
+void G_CopySnapshots(TArray<level_info_t *> &infos, TArray<FCompressedBuffer> &buffers)
+{
+	for (unsigned int i = 0; i < wadlevelinfos.Size(); i++)
+	{
+		if (wadlevelinfos[i].Snapshot.mCompressedSize > 0)
+		{
+			infos.Push(&wadlevelinfos[i]);
+			buffers.Push(CopySnapshot(wadlevelinfos[i].Snapshot));
+		}
+	}
+	if (TheDefaultLevelInfo.Snapshot.mCompressedSize > 0)
+	{
+		infos.Push(&TheDefaultLevelInfo);
+		buffers.Push(CopySnapshot(TheDefaultLevelInfo.Snapshot));
+	}
+}
+
+//==========================================================================
+//
+// G_RestoreSnapshots
+//
+// Replaces all level snapshots with copies of the ones G_CopySnapshots
+// returned. The passed buffers stay owned by the caller.
+//
+//==========================================================================
+
+void G_RestoreSnapshots(TArray<level_info_t *> &infos, TArray<FCompressedBuffer> &buffers)
+{
+	G_ClearSnapshots();
+	TheDefaultLevelInfo.Snapshot.Clean();
+	for (unsigned int i = 0; i < infos.Size(); i++)
+	{
+		infos[i]->Snapshot = CopySnapshot(buffers[i]);
+	}
+}
+
 //==========================================================================
 //
 //
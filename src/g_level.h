@@ -535,6 +535,8 @@ void G_SnapshotLevel (void);
 void G_UnSnapshotLevel (bool keepPlayers);
 void G_ReadSnapshots (FResourceFile *);
 void G_WriteSnapshots (TArray<FString> &, TArray<FCompressedBuffer> &);
+void G_CopySnapshots (TArray<level_info_t *> &, TArray<FCompressedBuffer> &);
+void G_RestoreSnapshots (TArray<level_info_t *> &, TArray<FCompressedBuffer> &);
 void G_WriteVisited(FSerializer &arc);
 void G_ReadVisited(FSerializer &arc);
 void G_ClearHubInfo();
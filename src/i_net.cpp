@@ -64,9 +64,14 @@
 #include "st_start.h"
 #include "m_misc.h"
 #include "doomstat.h"
+#include "stats.h"
+#include "d_protocol.h"
 
 #include "i_net.h"
 
+#include <atomic>
+#include <thread>
+
 // As per http://support.microsoft.com/kb/q192599/ the standard
 // size for network buffers is 8k.
 #define TRANSMIT_SIZE		8000
@@ -142,7 +147,193 @@ struct PreGamePacket
 	} machines[MAXNETNODES];
 };
 
-BYTE TransmitBuffer[TRANSMIT_SIZE];
+//==========================================================================
+//
+// Once the game has started, the socket belongs to a network thread. It
+// sends and receives packets and does their compression, so packets are
+// picked up as soon as they arrive instead of whenever the game thread gets
+// around to calling NetUpdate. The two threads hand packets to each other
+// through single-producer, single-consumer ring buffers.
+//
+//==========================================================================
+
+enum
+{
+	NETPACKET_DATA,
+	NETPACKET_DROPPED,		// The node's connection was reset
+	NETPACKET_ERROR,		// Data holds an error message
+	NETPACKET_CORRUPT,		// Could not be decompressed, Length holds the zlib error
+};
+
+struct FNetPacket
+{
+	int Node;
+	int Type;
+	int Length;
+	unsigned int Time;		// When it arrived, in I_FPSTime
+	BYTE Data[MAX_MSGLEN];
+};
+
+template<int N> class FNetPacketQueue
+{
+	FNetPacket Packets[N];
+	std::atomic<unsigned int> Head, Tail;
+
+public:
+	FNetPacketQueue() : Head(0), Tail(0) {}
+
+	// Returns the slot to fill in, or NULL if the queue is full.
+	FNetPacket *BeginPush()
+	{
+		unsigned int tail = Tail.load(std::memory_order_relaxed);
+		return tail - Head.load(std::memory_order_acquire) < N ? &Packets[tail % N] : NULL;
+	}
+	void EndPush()
+	{
+		Tail.store(Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Returns the oldest packet, or NULL if the queue is empty.
+	FNetPacket *Peek()
+	{
+		unsigned int head = Head.load(std::memory_order_relaxed);
+		return head != Tail.load(std::memory_order_acquire) ? &Packets[head % N] : NULL;
+	}
+	void Pop()
+	{
+		Head.store(Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+};
+
+static FNetPacketQueue<64> OutgoingPackets, IncomingPackets;
+static std::thread NetThread;
+static std::atomic<bool> NetThreadQuit;
+
+// Set by the network thread if a packet could not be sent. It cannot wait
+// for room in IncomingPackets to report that, because the game thread may
+// be waiting for room in OutgoingPackets at the same time.
+static std::atomic<bool> NetSendFailed;
+static int NetSendError;
+
+// Only used by the network thread once it is running.
+static BYTE TransmitBuffer[TRANSMIT_SIZE];
+
+// How long received packets waited for the game thread, in ms
+static double NetQueueDelay;
+static unsigned int NetQueueDelayMax;
+
+//==========================================================================
+//
+// Packet compression
+//
+// NETCOMPRESS_BEST is plain zlib at its highest level and is used until the
+// host picks something else in D_ArbitrateNetStart. NETCOMPRESS_FAST uses
+// the fastest level with a small window and a preset dictionary of typical
+// ticcmds, which does about as well on the small packets a game sends at a
+// fraction of the cost. The receiver can always tell from the zlib header
+// whether the dictionary was used, so nodes do not need to switch at the
+// exact same time.
+//
+//==========================================================================
+
+static std::atomic<int> NetCompression(NETCOMPRESS_BEST);
+static TArray<BYTE> NetDictionary;
+static z_stream DeflateStream, InflateStream;
+static bool DeflateReady, InflateReady;
+
+struct FNetNodeStats
+{
+	std::atomic<unsigned int> RawSent, WireSent;
+	std::atomic<unsigned int> RawReceived, WireReceived;
+	std::atomic<unsigned int> CodecMicroseconds;
+};
+static FNetNodeStats NodeStats[MAXNETNODES];
+
+void I_SetNetCompression (int mode)
+{
+	NetCompression = clamp (mode, (int)NETCOMPRESS_NONE, (int)NETCOMPRESS_BEST);
+}
+
+static int CompressPacket (const BYTE *in, int inlen, BYTE *out, uLong *outlen)
+{
+	int mode = NetCompression.load(std::memory_order_relaxed);
+
+	if (mode == NETCOMPRESS_NONE)
+	{
+		return Z_BUF_ERROR;
+	}
+	if (mode == NETCOMPRESS_BEST)
+	{
+		return compress2 (out, outlen, in, inlen, 9);
+	}
+
+	int err;
+	if (!DeflateReady)
+	{
+		memset (&DeflateStream, 0, sizeof(DeflateStream));
+		err = deflateInit2 (&DeflateStream, Z_BEST_SPEED, Z_DEFLATED, 12, 4, Z_DEFAULT_STRATEGY);
+		if (err != Z_OK)
+		{
+			return err;
+		}
+		DeflateReady = true;
+	}
+	else
+	{
+		deflateReset (&DeflateStream);
+	}
+	deflateSetDictionary (&DeflateStream, &NetDictionary[0], NetDictionary.Size());
+	DeflateStream.next_in = (Bytef *)in;
+	DeflateStream.avail_in = inlen;
+	DeflateStream.next_out = out;
+	DeflateStream.avail_out = (uInt)*outlen;
+	err = deflate (&DeflateStream, Z_FINISH);
+	if (err != Z_STREAM_END)
+	{
+		return err == Z_OK ? Z_BUF_ERROR : err;
+	}
+	*outlen = DeflateStream.total_out;
+	return Z_OK;
+}
+
+static int DecompressPacket (const BYTE *in, int inlen, BYTE *out, uLongf *outlen)
+{
+	int err;
+
+	if (!InflateReady)
+	{
+		memset (&InflateStream, 0, sizeof(InflateStream));
+		err = inflateInit (&InflateStream);
+		if (err != Z_OK)
+		{
+			return err;
+		}
+		InflateReady = true;
+	}
+	else
+	{
+		inflateReset (&InflateStream);
+	}
+	InflateStream.next_in = (Bytef *)in;
+	InflateStream.avail_in = inlen;
+	InflateStream.next_out = out;
+	InflateStream.avail_out = (uInt)*outlen;
+	err = inflate (&InflateStream, Z_FINISH);
+	if (err == Z_NEED_DICT)
+	{
+		err = inflateSetDictionary (&InflateStream, &NetDictionary[0], NetDictionary.Size());
+		if (err == Z_OK)
+		{
+			err = inflate (&InflateStream, Z_FINISH);
+		}
+	}
+	if (err != Z_STREAM_END)
+	{
+		return err == Z_OK ? Z_BUF_ERROR : err;
+	}
+	*outlen = InflateStream.total_out;
+	return Z_OK;
+}
 
 //
 // UDPsocket
@@ -196,62 +387,64 @@ int FindNode (const sockaddr_in *address)
 }
 
 //
-// PacketSend
+// SendNetPacket
 //
-void PacketSend (void)
+static void SendNetPacket (const FNetPacket *packet)
 {
+	FNetNodeStats &stats = NodeStats[packet->Node];
 	int c;
 
-	// FIXME: Catch this before we've overflown the buffer. With long chat
-	// text and lots of backup tics, it could conceivably happen. (Though
-	// apparently it hasn't yet, which is good.)
-	if (doomcom.datalength > MAX_MSGLEN)
-	{
-		I_FatalError("Netbuffer overflow!");
-	}
-	assert(!(doomcom.data[0] & NCMD_COMPRESSED));
+	assert(!(packet->Data[0] & NCMD_COMPRESSED));
 
 	uLong size = TRANSMIT_SIZE - 1;
-	if (doomcom.datalength >= 10)
+	if (packet->Length >= 10)
 	{
-		TransmitBuffer[0] = doomcom.data[0] | NCMD_COMPRESSED;
-		c = compress2(TransmitBuffer + 1, &size, doomcom.data + 1, doomcom.datalength - 1, 9);
+		cycle_t codectime;
+		codectime.Reset();
+		codectime.Clock();
+		TransmitBuffer[0] = packet->Data[0] | NCMD_COMPRESSED;
+		c = CompressPacket(packet->Data + 1, packet->Length - 1, TransmitBuffer + 1, &size);
 		size += 1;
+		codectime.Unclock();
+		stats.CodecMicroseconds.fetch_add(unsigned(codectime.TimeMS() * 1000), std::memory_order_relaxed);
 	}
 	else
 	{
 		c = -1;	// Just some random error code to avoid sending the compressed buffer.
 	}
-	if (c == Z_OK && size < (uLong)doomcom.datalength)
+	stats.RawSent.fetch_add(packet->Length, std::memory_order_relaxed);
+	if (c == Z_OK && size < (uLong)packet->Length)
 	{
-//		Printf("send %lu/%d\n", size, doomcom.datalength);
+		stats.WireSent.fetch_add(size, std::memory_order_relaxed);
+//		Printf("send %lu/%d\n", size, packet->Length);
 		c = sendto(mysocket, (char *)TransmitBuffer, size,
-			0, (sockaddr *)&sendaddress[doomcom.remotenode],
-			sizeof(sendaddress[doomcom.remotenode]));
+			0, (sockaddr *)&sendaddress[packet->Node],
+			sizeof(sendaddress[packet->Node]));
 	}
-	else
+	else if (packet->Length <= TRANSMIT_SIZE)
 	{
-		if (doomcom.datalength > TRANSMIT_SIZE)
-		{
-			I_Error("Net compression failed (zlib error %d)", c);
-		}
-		else
-		{
-//			Printf("send %d\n", doomcom.datalength);
-			c = sendto(mysocket, (char *)doomcom.data, doomcom.datalength,
-				0, (sockaddr *)&sendaddress[doomcom.remotenode],
-				sizeof(sendaddress[doomcom.remotenode]));
-		}
+		stats.WireSent.fetch_add(packet->Length, std::memory_order_relaxed);
+//		Printf("send %d\n", packet->Length);
+		c = sendto(mysocket, (char *)packet->Data, packet->Length,
+			0, (sockaddr *)&sendaddress[packet->Node],
+			sizeof(sendaddress[packet->Node]));
+	}
+	else if (!NetSendFailed.load(std::memory_order_relaxed))
+	{ // Let the game thread know, since it cannot be done from here.
+		NetSendError = c;
+		NetSendFailed.store(true, std::memory_order_release);
 	}
+
 	//	if (c == -1)
 	//			I_Error ("SendPacket error: %s",strerror(errno));
 }
 
-
 //
-// PacketGet
+// ReceiveNetPacket
 //
-void PacketGet (void)
+// Returns false if there is nothing more to read right now.
+//
+static bool ReceiveNetPacket (FNetPacket *packet)
 {
 	int c;
 	socklen_t fromlen;
@@ -263,73 +456,263 @@ void PacketGet (void)
 				  (sockaddr *)&fromaddress, &fromlen);
 	node = FindNode (&fromaddress);
 
-	if (node >= 0 && c == SOCKET_ERROR)
+	packet->Node = node;
+	packet->Type = NETPACKET_DATA;
+	packet->Time = I_FPSTime();
+
+	if (c == SOCKET_ERROR)
 	{
 		int err = WSAGetLastError();
 
-		if (err == WSAECONNRESET)
-		{ // The remote node aborted unexpectedly, so pretend it sent an exit packet
-
-			if (StartScreen != NULL)
-			{
-				StartScreen->NetMessage ("The connection from %s was dropped.\n",
-					players[sendplayer[node]].userinfo.GetName());
-			}
-			else
-			{
-				Printf("The connection from %s was dropped.\n",
-					players[sendplayer[node]].userinfo.GetName());
-			}
-
-			doomcom.data[0] = 0x80;	// NCMD_EXIT
-			c = 1;
+		if (err == WSAEWOULDBLOCK)
+		{
+			return false;
 		}
-		else if (err != WSAEWOULDBLOCK)
+		if (node < 0)
+		{
+			return true;	// Nothing to report
+		}
+		if (err == WSAECONNRESET)
 		{
-			I_Error ("GetPacket: %s", neterror ());
+			packet->Type = NETPACKET_DROPPED;
 		}
 		else
 		{
-			doomcom.remotenode = -1;		// no packet
-			return;
+			packet->Type = NETPACKET_ERROR;
+			mysnprintf ((char *)packet->Data, MAX_MSGLEN, "GetPacket: %s", neterror());
 		}
+		IncomingPackets.EndPush();
+		return true;
 	}
 	else if (node >= 0 && c > 0)
 	{
-		doomcom.data[0] = TransmitBuffer[0] & ~NCMD_COMPRESSED;
+		FNetNodeStats &stats = NodeStats[node];
+
+		stats.WireReceived.fetch_add(c, std::memory_order_relaxed);
+		packet->Data[0] = TransmitBuffer[0] & ~NCMD_COMPRESSED;
 		if (TransmitBuffer[0] & NCMD_COMPRESSED)
 		{
+			cycle_t codectime;
+			codectime.Reset();
+			codectime.Clock();
 			uLongf msgsize = MAX_MSGLEN - 1;
-			int err = uncompress(doomcom.data + 1, &msgsize, TransmitBuffer + 1, c - 1);
+			int err = DecompressPacket(TransmitBuffer + 1, c - 1, packet->Data + 1, &msgsize);
+			codectime.Unclock();
+			stats.CodecMicroseconds.fetch_add(unsigned(codectime.TimeMS() * 1000), std::memory_order_relaxed);
 //			Printf("recv %d/%lu\n", c, msgsize + 1);
 			if (err != Z_OK)
 			{
-				Printf("Net decompression failed (zlib error %s)\n", M_ZLibError(err).GetChars());
-				// Pretend no packet
-				doomcom.remotenode = -1;
-				return;
+				// The game thread reports it and will ask for the packet again.
+				packet->Type = NETPACKET_CORRUPT;
+				packet->Length = err;
+				IncomingPackets.EndPush();
+				return true;
 			}
 			c = msgsize + 1;
 		}
 		else
 		{
 //			Printf("recv %d\n", c);
-			memcpy(doomcom.data + 1, TransmitBuffer + 1, c - 1);
+			memcpy(packet->Data + 1, TransmitBuffer + 1, c - 1);
 		}
+		packet->Length = c;
+		stats.RawReceived.fetch_add(c, std::memory_order_relaxed);
+		IncomingPackets.EndPush();
 	}
-	else if (c > 0)
-	{	//The packet is not from any in-game node, so we might as well discard it.
-		// Don't show the message for disconnect notifications.
-		if (c != 2 || TransmitBuffer[0] != PRE_FAKE || TransmitBuffer[1] != PRE_DISCONNECT)
+	// Else the packet is not from any in-game node, so we might as well
+	// discard it.
+	return true;
+}
+
+//
+// NetThreadProc
+//
+static void NetThreadProc ()
+{
+	while (!NetThreadQuit.load(std::memory_order_relaxed))
+	{
+		FNetPacket *packet;
+
+		while ((packet = OutgoingPackets.Peek()) != NULL)
+		{
+			SendNetPacket (packet);
+			OutgoingPackets.Pop();
+		}
+
+		// Wait for something to arrive, but not so long that packets
+		// queued for sending are held up.
+		fd_set readset;
+		timeval timeout = { 0, 1000 };
+		FD_ZERO (&readset);
+		FD_SET (mysocket, &readset);
+		if (select ((int)mysocket + 1, &readset, NULL, NULL, &timeout) <= 0)
 		{
-			DPrintf(DMSG_WARNING, "Dropped packet: Unknown host (%s:%d)\n", inet_ntoa(fromaddress.sin_addr), fromaddress.sin_port);
+			continue;
+		}
+		while ((packet = IncomingPackets.BeginPush()) != NULL)
+		{
+			if (!ReceiveNetPacket (packet))
+			{
+				break;
+			}
+		}
+		if (packet == NULL)
+		{ // The game thread is not keeping up, so leave the rest in the socket for now.
+			Sleep (1);
 		}
+	}
+}
+
+static void StartNetThread ()
+{
+	MakeUserCmdDictionary (NetDictionary);
+	NetThreadQuit = false;
+	NetSendFailed = false;
+	NetThread = std::thread(NetThreadProc);
+}
+
+static void StopNetThread ()
+{
+	if (NetThread.joinable())
+	{
+		NetThreadQuit = true;
+		NetThread.join();
+	}
+	if (DeflateReady)
+	{
+		deflateEnd (&DeflateStream);
+		DeflateReady = false;
+	}
+	if (InflateReady)
+	{
+		inflateEnd (&InflateStream);
+		InflateReady = false;
+	}
+}
+
+//
+// CheckNetSendError
+//
+static void CheckNetSendError ()
+{
+	if (NetSendFailed.load(std::memory_order_acquire))
+	{
+		// Report it only once. D_QuitNetGame still sends packets after this.
+		NetSendFailed.store(false, std::memory_order_relaxed);
+		I_Error ("Net compression failed (zlib error %d)", NetSendError);
+	}
+}
+
+//
+// PacketSend
+//
+void PacketSend (void)
+{
+	FNetPacket *packet;
+
+	CheckNetSendError ();
+
+	// FIXME: Catch this before we've overflown the buffer. With long chat
+	// text and lots of backup tics, it could conceivably happen. (Though
+	// apparently it hasn't yet, which is good.)
+	if (doomcom.datalength > MAX_MSGLEN)
+	{
+		I_FatalError("Netbuffer overflow!");
+	}
+	while ((packet = OutgoingPackets.BeginPush()) == NULL)
+	{
+		std::this_thread::yield();
+	}
+	packet->Node = doomcom.remotenode;
+	packet->Type = NETPACKET_DATA;
+	packet->Length = doomcom.datalength;
+	memcpy (packet->Data, doomcom.data, doomcom.datalength);
+	OutgoingPackets.EndPush();
+}
+
+
+//
+// PacketGet
+//
+void PacketGet (void)
+{
+	CheckNetSendError ();
+
+	FNetPacket *packet = IncomingPackets.Peek();
+
+	if (packet == NULL)
+	{
+		doomcom.remotenode = -1;		// no packet
+		return;
+	}
+
+	int node = packet->Node;
+	unsigned int delay = I_FPSTime() - packet->Time;
+	NetQueueDelay = NetQueueDelay * 0.9 + delay * 0.1;
+	NetQueueDelayMax = MAX(NetQueueDelayMax, delay);
+
+	if (packet->Type == NETPACKET_ERROR)
+	{
+		FString message = (const char *)packet->Data;
+		IncomingPackets.Pop();
+		I_Error ("%s", message.GetChars());
+	}
+	else if (packet->Type == NETPACKET_CORRUPT)
+	{
+		Printf("Net decompression failed (zlib error %s)\n", M_ZLibError(packet->Length).GetChars());
+		IncomingPackets.Pop();
+		// Pretend no packet
 		doomcom.remotenode = -1;
 		return;
 	}
+	else if (packet->Type == NETPACKET_DROPPED)
+	{ // The remote node aborted unexpectedly, so pretend it sent an exit packet
 
+		if (StartScreen != NULL)
+		{
+			StartScreen->NetMessage ("The connection from %s was dropped.\n",
+				players[sendplayer[node]].userinfo.GetName());
+		}
+		else
+		{
+			Printf("The connection from %s was dropped.\n",
+				players[sendplayer[node]].userinfo.GetName());
+		}
+
+		doomcom.data[0] = 0x80;	// NCMD_EXIT
+		doomcom.datalength = 1;
+	}
+	else
+	{
+		memcpy (doomcom.data, packet->Data, packet->Length);
+		doomcom.datalength = (short)packet->Length;
+	}
 	doomcom.remotenode = node;
-	doomcom.datalength = (short)c;
+	IncomingPackets.Pop();
+}
+
+ADD_STAT (netqueue)
+{
+	FString out;
+	out.Format ("Received packets waited %.1f ms on average, %u ms at most", NetQueueDelay, NetQueueDelayMax);
+	return out;
+}
+
+ADD_STAT (netcodec)
+{
+	static const char *const modes[] = { "none", "fast", "best" };
+	FString out;
+
+	out.Format ("Compression: %s", modes[NetCompression.load()]);
+	for (int i = 1; i < doomcom.numnodes; ++i)
+	{
+		const FNetNodeStats &stats = NodeStats[i];
+		out.AppendFormat ("\nNode %d: sent %uk as %uk, received %uk as %uk, %u ms in zlib", i,
+			stats.RawSent.load() / 1024, stats.WireSent.load() / 1024,
+			stats.RawReceived.load() / 1024, stats.WireReceived.load() / 1024,
+			stats.CodecMicroseconds.load() / 1000);
+	}
+	return out;
 }
 
 sockaddr_in *PreGet (void *buffer, int bufferlen, bool noabort)
@@ -413,6 +796,7 @@ void BuildAddress (sockaddr_in *address, const char *name)
 
 void CloseNetwork (void)
 {
+	StopNetThread ();
 	if (mysocket != INVALID_SOCKET)
 	{
 		closesocket (mysocket);
@@ -985,6 +1369,8 @@ bool I_InitNetwork (void)
 		doomcom.consoleplayer = 0;
 		return false;
 	}
+	StartNetThread ();
+
 	if (doomcom.numnodes < 3)
 	{ // Packet server mode with only two players is effectively the same as
 	  // peer-to-peer but with some slightly larger packets.
@@ -27,4 +27,14 @@
 bool I_InitNetwork (void);
 void I_NetCmd (void);
 
+enum
+{
+	NETCOMPRESS_NONE,
+	NETCOMPRESS_FAST,		// Fastest zlib level with a preset ticcmd dictionary
+	NETCOMPRESS_BEST,		// Highest zlib level
+};
+
+// Picks how outgoing packets are compressed. Any node can read all of them.
+void I_SetNetCompression (int mode);
+
 #endif
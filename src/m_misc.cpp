@@ -31,6 +31,9 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <time.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "doomtype.h"
 #include "version.h"
@@ -600,16 +603,155 @@ void WritePCXfile (FileWriter *file, const BYTE *buffer, const PalEntry *palette
 //
 // WritePNGfile
 //
-void WritePNGfile (FileWriter *file, const BYTE *buffer, const PalEntry *palette,
+bool WritePNGfile (FileWriter *file, const BYTE *buffer, const PalEntry *palette,
 				   ESSType color_type, int width, int height, int pitch)
 {
 	char software[100];
 	mysnprintf(software, countof(software), GAMENAME " %s", GetVersionString());
-	if (!M_CreatePNG (file, buffer, palette, color_type, width, height, pitch) ||
-		!M_AppendPNGText (file, "Software", software) ||
-		!M_FinishPNG (file))
+	return M_CreatePNG (file, buffer, palette, color_type, width, height, pitch) &&
+		M_AppendPNGText (file, "Software", software) &&
+		M_FinishPNG (file);
+}
+
+//==========================================================================
+//
+// Screenshot writer
+//
+// Screenshots are copied out of the frame buffer and then encoded and
+// written on a separate thread so that taking one does not stall the
+// game. The results are reported by M_FinishScreenShots on the main
+// thread, since Printf is not thread safe.
+//
+//==========================================================================
+
+struct FScreenShotJob
+{
+	FileWriter *File;
+	FString FileName;
+	TArray<BYTE> Pixels;
+	PalEntry Palette[256];
+	ESSType ColorType;
+	int Width, Height, Pitch;
+	bool WritePCX;
+	bool Ok;
+};
+
+static std::mutex ScreenShotMutex;
+static std::condition_variable ScreenShotCond;
+static std::thread ScreenShotThread;
+static TArray<FScreenShotJob *> ScreenShotQueue;	// waiting to be written
+static TArray<FScreenShotJob *> ScreenShotsDone;	// waiting to be reported
+static bool ScreenShotQuit;
+
+static void WriteScreenShot (FScreenShotJob *job)
+{
+	if (job->WritePCX)
+	{
+		WritePCXfile(job->File, &job->Pixels[0], job->Palette, job->ColorType,
+			job->Width, job->Height, job->Pitch);
+		job->Ok = true;
+	}
+	else
+	{
+		job->Ok = WritePNGfile(job->File, &job->Pixels[0], job->Palette, job->ColorType,
+			job->Width, job->Height, job->Pitch);
+	}
+	delete job->File;
+	job->File = NULL;
+	job->Pixels.Clear();
+	job->Pixels.ShrinkToFit();
+}
+
+static void ScreenShotThreadProc ()
+{
+	std::unique_lock<std::mutex> lock(ScreenShotMutex);
+
+	for (;;)
 	{
-		Printf ("Could not create screenshot.\n");
+		ScreenShotCond.wait(lock, [] { return ScreenShotQuit || ScreenShotQueue.Size() > 0; });
+
+		// Everything that was queued still gets written before quitting.
+		if (ScreenShotQueue.Size() == 0)
+		{
+			break;
+		}
+		FScreenShotJob *job = ScreenShotQueue[0];
+		ScreenShotQueue.Delete(0);
+
+		lock.unlock();
+		WriteScreenShot(job);
+		lock.lock();
+
+		ScreenShotsDone.Push(job);
+	}
+}
+
+static void StopScreenShotThread ()
+{
+	{
+		std::lock_guard<std::mutex> lock(ScreenShotMutex);
+		ScreenShotQuit = true;
+	}
+	ScreenShotCond.notify_one();
+	ScreenShotThread.join();
+
+	for (auto job : ScreenShotsDone)
+	{
+		delete job;
+	}
+	ScreenShotsDone.Clear();
+}
+
+static void QueueScreenShot (FScreenShotJob *job)
+{
+	if (!ScreenShotThread.joinable())
+	{
+		ScreenShotThread = std::thread(ScreenShotThreadProc);
+		atterm (StopScreenShotThread);
+	}
+	{
+		std::lock_guard<std::mutex> lock(ScreenShotMutex);
+		ScreenShotQueue.Push(job);
+	}
+	ScreenShotCond.notify_one();
+}
+
+//==========================================================================
+//
+// M_FinishScreenShots
+//
+// Reports all screenshots the writer thread has finished since the last
+// call.
+//
+//==========================================================================
+
+void M_FinishScreenShots ()
+{
+	TArray<FScreenShotJob *> done;
+
+	{
+		std::lock_guard<std::mutex> lock(ScreenShotMutex);
+		if (ScreenShotsDone.Size() == 0)
+		{
+			return;
+		}
+		done = ScreenShotsDone;
+		ScreenShotsDone.Clear();
+	}
+
+	for (auto job : done)
+	{
+		if (!job->Ok)
+		{
+			Printf ("Could not create screenshot.\n");
+		}
+		else if (!screenshot_quiet)
+		{
+			int slash = -1;
+			if (!longsavemessages) slash = job->FileName.LastIndexOfAny(":/\\");
+			Printf ("Captured %s\n", job->FileName.GetChars()+slash+1);
+		}
+		delete job;
 	}
 }
 
@@ -662,7 +804,6 @@ static bool FindFreeName (FString &fullname, const char *extension)
 
 void M_ScreenShot (const char *filename)
 {
-	FileWriter *file;
 	FString autoname;
 	bool writepcx = (stricmp (screenshot_type, "pcx") == 0);	// PNG is the default
 
@@ -710,38 +851,37 @@ void M_ScreenShot (const char *filename)
 	screen->GetScreenshotBuffer(buffer, pitch, color_type);
 	if (buffer != NULL)
 	{
-		PalEntry palette[256];
+		FScreenShotJob *job = new FScreenShotJob;
 
 		if (color_type == SS_PAL)
 		{
-			screen->GetFlashedPalette(palette);
+			screen->GetFlashedPalette(job->Palette);
 		}
-		file = FileWriter::Open(autoname);
-		if (file == NULL)
+		// The file is created right away so that the next screenshot
+		// does not pick the same name.
+		job->File = FileWriter::Open(autoname);
+		if (job->File == NULL)
 		{
 			Printf ("Could not open %s\n", autoname.GetChars());
 			screen->ReleaseScreenshotBuffer();
+			delete job;
 			return;
 		}
-		if (writepcx)
-		{
-			WritePCXfile(file, buffer, palette, color_type,
-				screen->GetWidth(), screen->GetHeight(), pitch);
-		}
-		else
+		job->FileName = autoname;
+		job->ColorType = color_type;
+		job->Width = screen->GetWidth();
+		job->Height = screen->GetHeight();
+		job->Pitch = job->Width * (color_type == SS_PAL ? 1 : color_type == SS_RGB ? 3 : 4);
+		job->WritePCX = writepcx;
+
+		job->Pixels.Resize(job->Pitch * job->Height);
+		for (int y = 0; y < job->Height; ++y)
 		{
-			WritePNGfile(file, buffer, palette, color_type,
-				screen->GetWidth(), screen->GetHeight(), pitch);
+			memcpy(&job->Pixels[y * job->Pitch], buffer + y * pitch, job->Pitch);
 		}
-		delete file;
 		screen->ReleaseScreenshotBuffer();
 
-		if (!screenshot_quiet)
-		{
-			int slash = -1;
-			if (!longsavemessages) slash = autoname.LastIndexOfAny(":/\\");
-			Printf ("Captured %s\n", autoname.GetChars()+slash+1);
-		}
+		QueueScreenShot(job);
 	}
 	else
 	{
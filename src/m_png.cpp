@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <zlib.h>
+#include <thread>
 #ifdef _MSC_VER
 #include <malloc.h>		// for alloca()
 #endif
@@ -62,6 +63,11 @@
 // determine, so that's why this is 0 here.
 #define USE_FILTER_HEURISTIC 0
 
+// Images are compressed in up to this many stripes in parallel, but no
+// stripe gets less than MIN_PNG_STRIPE_ROWS rows.
+#define MAX_PNG_STRIPES			16
+#define MIN_PNG_STRIPE_ROWS		64
+
 // TYPES -------------------------------------------------------------------
 
 struct IHDR
@@ -897,14 +903,28 @@ static int SelectFilter(Byte row[5][1 + MAXWIDTH*3], Byte prior[MAXWIDTH*3], int
 
 //==========================================================================
 //
-// M_SaveBitmap
+// PNGStripe
 //
-// Given a bitmap, creates one or more IDAT chunks in the given file.
-// Returns true on success.
+// The rows of an image are split into stripes that get filtered and
+// deflated independently on their own threads. Every stripe except the
+// last ends with a sync flush so that the raw deflate streams can simply
+// be concatenated, and their Adler-32 checksums are combined afterwards.
+// Losing the dictionary at the stripe boundaries costs a few bytes at most.
 //
 //==========================================================================
 
-bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, int pitch, FileWriter *file)
+struct PNGStripe
+{
+	const BYTE *From;
+	int NumRows;
+	bool First, Last;
+	bool Ok;
+	uLong Adler;
+	uLong InLength;
+	TArray<BYTE> Output;
+};
+
+static void CompressStripe(PNGStripe *stripe, ESSType color_type, int width, int pitch)
 {
 #if USE_FILTER_HEURISTIC
 	Byte prior[MAXWIDTH*3];
@@ -913,24 +933,31 @@ bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, i
 	Byte temprow[1][1 + MAXWIDTH*3];
 #endif
 	Byte buffer[PNG_WRITE_SIZE];
+	const BYTE *from = stripe->From;
 	z_stream stream;
 	int err;
-	int y;
+
+	stripe->Ok = false;
+	stripe->Adler = adler32(0, Z_NULL, 0);
+	stripe->InLength = 0;
 
 	stream.next_in = Z_NULL;
 	stream.avail_in = 0;
 	stream.zalloc = Z_NULL;
 	stream.zfree = Z_NULL;
-	err = deflateInit (&stream, png_level);
+	err = deflateInit2 (&stream, png_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
 
 	if (err != Z_OK)
 	{
-		return false;
+		return;
 	}
 
-	y = height;
-	stream.next_out = buffer;
-	stream.avail_out = sizeof(buffer);
+	if (stripe->First)
+	{
+		// zlib stream header for the entire image
+		stripe->Output.Push(0x78);
+		stripe->Output.Push(0x01);
+	}
 
 	temprow[0][0] = 0;
 #if USE_FILTER_HEURISTIC
@@ -939,15 +966,29 @@ bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, i
 	temprow[3][0] = 3;
 	temprow[4][0] = 4;
 
-	// Fill the prior row with 0 for RGB images. Paletted is always filter 0,
+	// Fill the prior row with 0 for RGB images at the top of the image, or
+	// with the row above this stripe otherwise. Paletted is always filter 0,
 	// so it doesn't need this.
-	if (color_type != SS_PAL)
+	if (color_type == SS_RGB && !stripe->First)
+	{
+		memcpy(prior, from - pitch, width * 3);
+	}
+	else if (color_type == SS_BGRA && !stripe->First)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			prior[x*3 + 0] = from[x*4 - pitch + 2];
+			prior[x*3 + 1] = from[x*4 - pitch + 1];
+			prior[x*3 + 2] = from[x*4 - pitch];
+		}
+	}
+	else if (color_type != SS_PAL)
 	{
 		memset(prior, 0, width * 3);
 	}
 #endif
 
-	while (y-- > 0 && err == Z_OK)
+	for (int y = stripe->NumRows; y-- > 0; )
 	{
 		switch (color_type)
 		{
@@ -982,58 +1023,108 @@ bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, i
 			memcpy (prior, &temprow[0][1], stream.avail_in - 1);
 		}
 #endif
+		stripe->Adler = adler32(stripe->Adler, stream.next_in, stream.avail_in);
+		stripe->InLength += stream.avail_in;
 
 		from += pitch;
 
-		err = deflate (&stream, (y == 0) ? Z_FINISH : 0);
-		if (err != Z_OK)
-		{
-			break;
-		}
-		while (stream.avail_out == 0)
+		int flush = y > 0 ? Z_NO_FLUSH : stripe->Last ? Z_FINISH : Z_SYNC_FLUSH;
+		do
 		{
-			if (!WriteIDAT (file, buffer, sizeof(buffer)))
-			{
-				return false;
-			}
 			stream.next_out = buffer;
 			stream.avail_out = sizeof(buffer);
-			if (stream.avail_in != 0)
+			err = deflate (&stream, flush);
+			if (err == Z_STREAM_ERROR)
 			{
-				err = deflate (&stream, (y == 0) ? Z_FINISH : 0);
-				if (err != Z_OK)
-				{
-					break;
-				}
+				deflateEnd (&stream);
+				return;
 			}
-		}
-	}
-
-	while (err == Z_OK)
-	{
-		err = deflate (&stream, Z_FINISH);
-		if (err != Z_OK)
-		{
-			break;
-		}
-		if (stream.avail_out == 0)
-		{
-			if (!WriteIDAT (file, buffer, sizeof(buffer)))
+			unsigned int len = unsigned(sizeof(buffer) - stream.avail_out);
+			if (len > 0)
 			{
-				return false;
+				memcpy(&stripe->Output[stripe->Output.Reserve(len)], buffer, len);
 			}
-			stream.next_out = buffer;
-			stream.avail_out = sizeof(buffer);
 		}
+		while (stream.avail_out == 0);
 	}
 
 	deflateEnd (&stream);
+	stripe->Ok = stripe->Last ? err == Z_STREAM_END : true;
+}
+
+//==========================================================================
+//
+// M_SaveBitmap
+//
+// Given a bitmap, creates one or more IDAT chunks in the given file.
+// Returns true on success.
+//
+//==========================================================================
+
+bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, int pitch, FileWriter *file)
+{
+	int numstripes = clamp<int>(std::thread::hardware_concurrency(), 1, MAX_PNG_STRIPES);
+	numstripes = clamp(height / MIN_PNG_STRIPE_ROWS, 1, numstripes);
+
+	PNGStripe stripes[MAX_PNG_STRIPES];
+	std::thread threads[MAX_PNG_STRIPES];
+	int row = 0;
+
+	for (int i = 0; i < numstripes; ++i)
+	{
+		int nextrow = height * (i + 1) / numstripes;
+		stripes[i].From = from + row * pitch;
+		stripes[i].NumRows = nextrow - row;
+		stripes[i].First = i == 0;
+		stripes[i].Last = i == numstripes - 1;
+		row = nextrow;
+	}
 
-	if (err != Z_STREAM_END)
+	// The first stripe gets compressed on this thread.
+	for (int i = 1; i < numstripes; ++i)
+	{
+		threads[i] = std::thread(CompressStripe, &stripes[i], color_type, width, pitch);
+	}
+	CompressStripe(&stripes[0], color_type, width, pitch);
+
+	bool ok = true;
+	uLong adler = stripes[0].Adler;
+	for (int i = 1; i < numstripes; ++i)
+	{
+		threads[i].join();
+		adler = adler32_combine(adler, stripes[i].Adler, stripes[i].InLength);
+	}
+	for (int i = 0; i < numstripes; ++i)
+	{
+		ok &= stripes[i].Ok;
+	}
+	if (!ok)
 	{
 		return false;
 	}
-	return WriteIDAT (file, buffer, sizeof(buffer)-stream.avail_out);
+
+	// The zlib stream ends with the checksum of all the uncompressed data.
+	BYTE trailer[4] = { BYTE(adler >> 24), BYTE(adler >> 16), BYTE(adler >> 8), BYTE(adler) };
+	TArray<BYTE> &last = stripes[numstripes - 1].Output;
+	memcpy(&last[last.Reserve(4)], trailer, 4);
+
+	for (int i = 0; i < numstripes; ++i)
+	{
+		const BYTE *data = &stripes[i].Output[0];
+		unsigned int len = stripes[i].Output.Size();
+
+		while (len > 0)
+		{
+			unsigned int chunk = MIN<unsigned int>(len, PNG_WRITE_SIZE);
+			if (!WriteIDAT (file, data, chunk))
+			{
+				return false;
+			}
+			data += chunk;
+			len -= chunk;
+		}
+	}
+	return true;
 }
 
 //==========================================================================
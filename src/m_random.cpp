@@ -167,11 +167,27 @@ FRandom::FRandom ()
 //==========================================================================
 
 FRandom::FRandom (const char *name)
+: FRandom (CalcCRC32 ((const BYTE *)name, (unsigned int)strlen (name)))
 {
-	NameCRC = CalcCRC32 ((const BYTE *)name, (unsigned int)strlen (name));
 #ifndef NDEBUG
-	initialized = false;
 	Name = name;
+#endif
+}
+
+//==========================================================================
+//
+// FRandom - CRC constructor
+//
+// For RNGs whose name is only known by its CRC.
+//
+//==========================================================================
+
+FRandom::FRandom (DWORD crc)
+{
+	NameCRC = crc;
+#ifndef NDEBUG
+	initialized = false;
+	Name = NULL;
 	// A CRC of 0 is reserved for nameless RNGs that don't get stored
 	// in savegames. The chance is very low that you would get a CRC of 0,
 	// but it's still possible.
@@ -400,6 +416,33 @@ FRandom *FRandom::StaticFindRNG (const char *name)
 	return probe;
 }
 
+//==========================================================================
+//
+// FRandom :: StaticFindRNGByCRC
+//
+// The same for an RNG that is only known by its CRC, which is what
+// cached script code records.
+//
+//==========================================================================
+
+FRandom *FRandom::StaticFindRNGByCRC (DWORD crc)
+{
+	if (crc == 0) return &pr_exrandom;
+
+	FRandom *probe = RNGList;
+
+	while (probe != NULL && probe->NameCRC < crc)
+	{
+		probe = probe->Next;
+	}
+	if (probe == NULL || probe->NameCRC != crc)
+	{
+		probe = new FRandom(crc);
+		NewRNGs.Push(probe);
+	}
+	return probe;
+}
+
 //==========================================================================
 //
 // FRandom :: StaticPrintSeeds
@@ -48,6 +48,8 @@ public:
 	FRandom (const char *name);
 	~FRandom ();
 
+	DWORD GetCRC() const { return NameCRC; }
+
 	// Returns a random number in the range [0,255]
 	int operator()()
 	{
@@ -177,12 +179,15 @@ public:
 	static void StaticReadRNGState (FSerializer &arc);
 	static void StaticWriteRNGState (FSerializer &file);
 	static FRandom *StaticFindRNG(const char *name);
+	static FRandom *StaticFindRNGByCRC(DWORD crc);
 
 #ifndef NDEBUG
 	static void StaticPrintSeeds ();
 #endif
 
 private:
+	explicit FRandom (DWORD crc);
+
 #ifndef NDEBUG
 	const char *Name;
 #endif
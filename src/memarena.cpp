@@ -218,7 +218,7 @@ FMemArena::Block *FMemArena::AddBlock(size_t size)
 
 void FMemArena::Block::Reset()
 {
-	Avail = RoundPointer(this + sizeof(*this));
+	Avail = RoundPointer((BYTE *)this + sizeof(*this));
 }
 
 //==========================================================================
@@ -65,11 +65,10 @@ FRandom pr_railtrail("RailTrail");
 #define FADEFROMTTL(a)	(255/(a))
 
 // [RH] particle globals
-WORD			NumParticles;
-WORD			ActiveParticles;
-WORD			InactiveParticles;
+uint32_t		NumParticles;
+uint32_t		ActiveParticles;	// the first ActiveParticles entries of Particles are in use
 particle_t		*Particles;
-TArray<WORD>	ParticlesInSubsec;
+TArray<uint32_t>	ParticlesInSubsec;
 
 static int grey1, grey2, grey3, grey4, red, green, blue, yellow, black,
 		   red1, green1, blue1, yellow1, purple, purple1, white,
@@ -112,12 +111,10 @@ static const struct ColorList {
 inline particle_t *NewParticle (void)
 {
 	particle_t *result = NULL;
-	if (InactiveParticles != NO_PARTICLE)
+	if (ActiveParticles < NumParticles)
 	{
-		result = Particles + InactiveParticles;
-		InactiveParticles = result->tnext;
-		result->tnext = ActiveParticles;
-		ActiveParticles = WORD(result - Particles);
+		result = Particles + ActiveParticles++;
+		memset (result, 0, sizeof(particle_t));
 	}
 	return result;
 }
@@ -134,8 +131,8 @@ CUSTOM_CVAR( Int, r_maxparticles, 4000, CVAR_ARCHIVE )
 {
 	if ( self == 0 )
 		self = 4000;
-	else if (self > 65535)
-		self = 65535;
+	else if (self > MAX_PARTICLES)
+		self = MAX_PARTICLES;
 	else if (self < 100)
 		self = 100;
 
@@ -158,7 +155,7 @@ void P_InitParticles ()
 		num = r_maxparticles;
 
 	// This should be good, but eh...
-	NumParticles = (WORD)clamp<int>(num, 100, 65535);
+	NumParticles = (uint32_t)clamp<int>(num, 100, MAX_PARTICLES);
 
 	P_DeinitParticles();
 	Particles = new particle_t[NumParticles];
@@ -177,19 +174,11 @@ void P_DeinitParticles()
 
 void P_ClearParticles ()
 {
-	int i;
-
-	memset (Particles, 0, NumParticles * sizeof(particle_t));
-	ActiveParticles = NO_PARTICLE;
-	InactiveParticles = 0;
-	for (i = 0; i < NumParticles-1; i++)
-		Particles[i].tnext = i + 1;
-	Particles[i].tnext = NO_PARTICLE;
+	ActiveParticles = 0;
 }
 
-// Group particles by subsectors. Because particles are always
-// in motion, there is little benefit to caching this information
-// from one frame to the next.
+// Group particles by subsectors. P_ThinkParticles keeps each particle's
+// subsector up to date, so this only needs to link them together.
 
 void P_FindParticleSubsectors ()
 {
@@ -198,18 +187,19 @@ void P_FindParticleSubsectors ()
 		ParticlesInSubsec.Reserve (numsubsectors - ParticlesInSubsec.Size());
 	}
 
-	fillshort (&ParticlesInSubsec[0], numsubsectors, NO_PARTICLE);
+	// NO_PARTICLE is all bits set.
+	memset (&ParticlesInSubsec[0], 0xff, numsubsectors * sizeof(uint32_t));
 
 	if (!r_particles)
 	{
 		return;
 	}
-	for (WORD i = ActiveParticles; i != NO_PARTICLE; i = Particles[i].tnext)
+	for (uint32_t i = 0; i < ActiveParticles; i++)
 	{
-		 // Try to reuse the subsector from the last portal check, if still valid.
-		if (Particles[i].subsector == NULL) Particles[i].subsector = R_PointInSubsector(Particles[i].Pos);
-		int ssnum = int(Particles[i].subsector - subsectors);
-		Particles[i].snext = ParticlesInSubsec[ssnum];
+		particle_t *particle = Particles + i;
+		if (particle->subsector == NULL) particle->subsector = R_PointInSubsector(particle->Pos);
+		int ssnum = int(particle->subsector - subsectors);
+		particle->snext = ParticlesInSubsec[ssnum];
 		ParticlesInSubsec[ssnum] = i;
 	}
 }
@@ -254,18 +244,15 @@ void P_InitEffects ()
 
 void P_ThinkParticles ()
 {
-	int i;
-	particle_t *particle, *prev;
+	bool frozen = bglobal.freeze || (level.flags2 & LEVEL2_FROZEN);
+	uint32_t i = 0;
 
-	i = ActiveParticles;
-	prev = NULL;
-	while (i != NO_PARTICLE)
+	while (i < ActiveParticles)
 	{
-		particle = Particles + i;
-		i = particle->tnext;
-		if (!particle->notimefreeze && ((bglobal.freeze) || (level.flags2 & LEVEL2_FROZEN)))
+		particle_t *particle = Particles + i;
+		if (!particle->notimefreeze && frozen)
 		{
-			prev = particle;
+			i++;
 			continue;
 		}
 		
@@ -274,24 +261,27 @@ void P_ThinkParticles ()
 		particle->trans -= particle->fade;
 		particle->size += particle->sizestep;
 		if (oldtrans < particle->trans || --particle->ttl <= 0 || (particle->size <= 0))
-		{ // The particle has expired, so free it
-			memset (particle, 0, sizeof(particle_t));
-			if (prev)
-				prev->tnext = i;
-			else
-				ActiveParticles = i;
-			particle->tnext = InactiveParticles;
-			InactiveParticles = (int)(particle - Particles);
+		{ // The particle has expired, so move the last active one into its place
+			// and think that one next.
+			if (i != --ActiveParticles)
+			{
+				*particle = Particles[ActiveParticles];
+			}
 			continue;
 		}
 
 		// Handle crossing a line portal
 		DVector2 newxy = P_GetOffsetPosition(particle->Pos.X, particle->Pos.Y, particle->Vel.X, particle->Vel.Y);
+		bool moved = newxy.X != particle->Pos.X || newxy.Y != particle->Pos.Y;
 		particle->Pos.X = newxy.X;
 		particle->Pos.Y = newxy.Y;
 		particle->Pos.Z += particle->Vel.Z;
 		particle->Vel += particle->Acc;
-		particle->subsector = R_PointInSubsector(particle->Pos);
+		// Particles that did not move horizontally cannot have changed their subsector.
+		if (moved || particle->subsector == NULL)
+		{
+			particle->subsector = R_PointInSubsector(particle->Pos);
+		}
 		sector_t *s = particle->subsector->sector;
 		// Handle crossing a sector portal.
 		if (!s->PortalBlocksMovement(sector_t::ceiling))
@@ -310,7 +300,7 @@ void P_ThinkParticles ()
 				particle->subsector = NULL;
 			}
 		}
-		prev = particle;
+		i++;
 	}
 }
 
@@ -51,6 +51,9 @@
 struct subsector_t;
 
 // [RH] Particle details
+//
+// Active particles are kept packed at the start of the Particles array,
+// so thinking them is a linear walk and no free list is needed.
 
 struct particle_t
 {
@@ -64,16 +67,17 @@ struct particle_t
 	BYTE	bright;
 	BYTE	fade;
 	int		color;
-	WORD	tnext;
-	WORD	snext;
+	uint32_t snext;
 	subsector_t * subsector;
 	bool	notimefreeze;
 };
 
 extern particle_t *Particles;
-extern TArray<WORD>		ParticlesInSubsec;
+extern uint32_t		ActiveParticles;
+extern TArray<uint32_t>	ParticlesInSubsec;
 
-const WORD NO_PARTICLE = 0xffff;
+const uint32_t NO_PARTICLE = 0xffffffff;
+const int MAX_PARTICLES = 1 << 20;
 
 void P_ClearParticles ();
 void P_FindParticleSubsectors ();
@@ -76,6 +76,7 @@ CVAR(Float, gl_cachetime, 0.6f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 void P_LoadZNodes (FileReader &dalump, DWORD id);
 static bool CheckCachedNodes(MapData *map);
 static void CreateCachedNodes(MapData *map);
+static bool ReadCachedBlockMapChunk(MapData *map, TArray<BYTE> &chunk);
 
 
 // fixed 32 bit gl_vert format v2.0+ (glBsp 1.91)
@@ -910,7 +911,7 @@ bool P_LoadGLNodes(MapData * map)
 				// GL nodes are loaded with a WAD
 				for(int i=0;i<4;i++)
 				{
-					gwalumps[i]=Wads.ReopenLumpNum(li+i+1);
+					gwalumps[i]=P_OpenMapLump(li+i+1);
 				}
 				return DoLoadGLNodes(gwalumps);
 			}
@@ -1154,9 +1155,13 @@ static void CreateCachedNodes(MapData *map)
 		}
 	}
 
+	// Keep a blockmap that has already been cached for this map.
+	MemFile BlockMapChunk;
+	ReadCachedBlockMapChunk(map, BlockMapChunk);
+
 	uLongf outlen = ZNodes.Size();
 	BYTE *compressed;
-	int offset = numlines * 8 + 12 + 16;
+	int offset = numlines * 8 + 12 + 16 + BlockMapChunk.Size();
 	int r;
 	do
 	{
@@ -1179,6 +1184,10 @@ static void CreateCachedNodes(MapData *map)
 		DWORD ndx[2] = {LittleLong(DWORD(lines[i].v1 - vertexes)), LittleLong(DWORD(lines[i].v2 - vertexes)) };
 		memcpy(compressed+8+16+8*i, ndx, 8);
 	}
+	if (BlockMapChunk.Size() > 0)
+	{
+		memcpy(compressed+8+16+8*numlines, &BlockMapChunk[0], BlockMapChunk.Size());
+	}
 	memcpy(compressed + offset - 4, "ZGL3", 4);
 
 	FString path = CreateCacheName(map, true);
@@ -1229,6 +1238,14 @@ static bool CheckCachedNodes(MapData *map)
 	if (fread(verts, 8, numlin, f) != numlin) goto errorout;
 
 	if (fread(magic, 1, 4, f) != 4) goto errorout;
+	if (!memcmp(magic, "BMAP", 4))
+	{
+		// Skip the cached blockmap.
+		DWORD chunklen;
+		if (fread(&chunklen, 4, 1, f) != 1) goto errorout;
+		if (fseek(f, LittleLong(chunklen), SEEK_CUR) != 0) goto errorout;
+		if (fread(magic, 1, 4, f) != 4) goto errorout;
+	}
 	if (memcmp(magic, "ZGL2", 4) && memcmp(magic, "ZGL3", 4))  goto errorout;
 
 
@@ -1280,6 +1297,220 @@ errorout:
 	return false;
 }
 
+//==========================================================================
+//
+// Blockmap caching
+//
+// A generated blockmap is stored in the node cache file as an optional
+// chunk between the line table and the nodes:
+//
+//   "BMAP", chunk length, number of ints, zlib-compressed blockmap
+//
+// A file that only holds a blockmap has "NONE" where the nodes would go.
+//
+//==========================================================================
+
+static FILE *OpenValidCacheFile(MapData *map)
+{
+	char magic[4];
+	BYTE md5[16];
+	BYTE md5map[16];
+	DWORD numlin;
+
+	FString path = CreateCacheName(map, false);
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+
+	if (fread(magic, 1, 4, f) == 4 && !memcmp(magic, "CACH", 4) &&
+		fread(&numlin, 4, 1, f) == 1 && (int)LittleLong(numlin) == numlines &&
+		fread(md5, 1, 16, f) == 16)
+	{
+		map->GetChecksum(md5map);
+		if (!memcmp(md5, md5map, 16) && fseek(f, numlines * 8, SEEK_CUR) == 0)
+		{
+			return f;
+		}
+	}
+	fclose(f);
+	return NULL;
+}
+
+static bool ReadCachedBlockMapChunk(MapData *map, TArray<BYTE> &chunk)
+{
+	FILE *f = OpenValidCacheFile(map);
+	if (f == NULL) return false;
+
+	char magic[4];
+	DWORD rawlen;
+	bool ok = false;
+
+	if (fread(magic, 1, 4, f) == 4 && !memcmp(magic, "BMAP", 4) && fread(&rawlen, 4, 1, f) == 1)
+	{
+		DWORD chunklen = LittleLong(rawlen);
+		chunk.Resize(8 + chunklen);
+		memcpy(&chunk[0], magic, 4);
+		memcpy(&chunk[4], &rawlen, 4);
+		ok = fread(&chunk[8], 1, chunklen, f) == chunklen;
+		if (!ok) chunk.Clear();
+	}
+	fclose(f);
+	return ok;
+}
+
+//==========================================================================
+//
+// P_LoadCachedBlockMap
+//
+// Returns a new[]'d blockmap if one has been cached for this map.
+//
+//==========================================================================
+
+int *P_LoadCachedBlockMap(MapData *map, int *count)
+{
+	if (!gl_cachenodes || level.maptype == MAPTYPE_BUILD)
+	{
+		return NULL;
+	}
+
+	TArray<BYTE> chunk;
+	if (!ReadCachedBlockMapChunk(map, chunk) || chunk.Size() < 12)
+	{
+		return NULL;
+	}
+
+	DWORD numints = LittleLong(*(DWORD *)&chunk[8]);
+	if (numints < 4 || numints > 0x10000000)
+	{
+		return NULL;
+	}
+
+	int *blockmap = new int[numints];
+	uLongf outlen = numints * sizeof(int);
+	if (uncompress((Bytef *)blockmap, &outlen, &chunk[12], chunk.Size() - 12) != Z_OK || outlen != numints * sizeof(int))
+	{
+		delete[] blockmap;
+		return NULL;
+	}
+	for (DWORD i = 0; i < numints; i++)
+	{
+		blockmap[i] = LittleLong(blockmap[i]);
+	}
+	*count = numints;
+	return blockmap;
+}
+
+//==========================================================================
+//
+// P_CacheBlockMap
+//
+// Adds a generated blockmap to the map's cache file, keeping any nodes
+// that have been cached there already.
+//
+//==========================================================================
+
+void P_CacheBlockMap(MapData *map, const int *blockmap, int count, int buildtime)
+{
+	if (!gl_cachenodes || level.maptype == MAPTYPE_BUILD || buildtime/1000.f < gl_cachetime)
+	{
+		return;
+	}
+
+	MemFile header, rest;
+	FILE *f = OpenValidCacheFile(map);
+
+	if (f != NULL)
+	{
+		// Keep the header and nodes of the existing file but drop its blockmap.
+		long headerlen = ftell(f);
+		header.Resize(headerlen);
+		fseek(f, 0, SEEK_SET);
+		bool ok = fread(&header[0], 1, headerlen, f) == (size_t)headerlen;
+
+		char magic[4];
+		DWORD chunklen;
+		if (ok && fread(magic, 1, 4, f) == 4)
+		{
+			if (!memcmp(magic, "BMAP", 4))
+			{
+				ok = fread(&chunklen, 4, 1, f) == 1 && fseek(f, LittleLong(chunklen), SEEK_CUR) == 0;
+			}
+			else
+			{
+				ok = fseek(f, -4, SEEK_CUR) == 0;
+			}
+			BYTE buffer[4096];
+			size_t len;
+			while (ok && (len = fread(buffer, 1, sizeof(buffer), f)) > 0)
+			{
+				unsigned pos = rest.Reserve(len);
+				memcpy(&rest[pos], buffer, len);
+			}
+		}
+		fclose(f);
+		if (!ok)
+		{
+			header.Clear();
+			rest.Clear();
+		}
+	}
+	if (header.Size() == 0)
+	{
+		BYTE md5[16];
+		header.Resize(4);
+		memcpy(&header[0], "CACH", 4);
+		WriteLong(header, numlines);
+		map->GetChecksum(md5);
+		for (int i = 0; i < 16; i++) WriteByte(header, md5[i]);
+		for (int i = 0; i < numlines; i++)
+		{
+			WriteLong(header, DWORD(lines[i].v1 - vertexes));
+			WriteLong(header, DWORD(lines[i].v2 - vertexes));
+		}
+	}
+	if (rest.Size() == 0)
+	{
+		rest.Resize(4);
+		memcpy(&rest[0], "NONE", 4);
+	}
+
+	TArray<int> swapped;
+	swapped.Resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		swapped[i] = LittleLong(blockmap[i]);
+	}
+	uLongf outlen = compressBound(count * sizeof(int));
+	MemFile chunk;
+	chunk.Resize(12 + outlen);
+	if (compress(&chunk[12], &outlen, (const Bytef *)&swapped[0], count * sizeof(int)) != Z_OK)
+	{
+		return;
+	}
+	chunk.Resize(12 + outlen);
+	memcpy(&chunk[0], "BMAP", 4);
+	DWORD v = LittleLong(DWORD(outlen + 4));
+	memcpy(&chunk[4], &v, 4);
+	v = LittleLong(DWORD(count));
+	memcpy(&chunk[8], &v, 4);
+
+	FString path = CreateCacheName(map, true);
+	f = fopen(path, "wb");
+	if (f != NULL)
+	{
+		if (fwrite(&header[0], header.Size(), 1, f) != 1 ||
+			fwrite(&chunk[0], chunk.Size(), 1, f) != 1 ||
+			fwrite(&rest[0], rest.Size(), 1, f) != 1)
+		{
+			Printf("Error saving blockmap to file %s\n", path.GetChars());
+		}
+		fclose(f);
+	}
+	else
+	{
+		Printf("Cannot open nodes file %s for writing\n", path.GetChars());
+	}
+}
+
 CCMD(clearnodecache)
 {
 	TArray<FFileList> list;
@@ -774,7 +774,7 @@ DEFINE_ACTION_FUNCTION(AActor, Die)
 
 void AActor::CallDie(AActor *source, AActor *inflictor, int dmgflags)
 {
-	IFVIRTUAL(AActor, Die)
+	IFOVERRIDENVIRTUAL(AActor, Die)
 	{
 		VMValue params[4] = { (DObject*)this, source, inflictor, dmgflags };
 		GlobalVMStack.Call(func, params, 4, nullptr, 0, nullptr);
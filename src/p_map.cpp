@@ -1258,6 +1258,7 @@ bool PIT_CheckThing(FMultiBlockThingsIterator &it, FMultiBlockThingsIterator::Ch
 		((tm.thing->flags & (MF_SOLID|MF_MISSILE)) || (tm.thing->flags2 & MF2_BLASTED) || (tm.thing->flags6 & MF6_BLOCKEDBYSOLIDACTORS) || (tm.thing->BounceFlags & BOUNCE_MBF)))
 	{
 		static unsigned VIndex = ~0u;
+		static FVirtualCache VCache;
 		if (VIndex == ~0u)
 		{
 			VIndex = GetVirtualIndex(RUNTIME_CLASS(AActor), "CanCollideWith");
@@ -1269,8 +1270,7 @@ bool PIT_CheckThing(FMultiBlockThingsIterator &it, FMultiBlockThingsIterator::Ch
 		int retval;
 		ret.IntAt(&retval);
 
-		auto clss = tm.thing->GetClass();
-		VMFunction *func = clss->Virtuals.Size() > VIndex ? clss->Virtuals[VIndex] : nullptr;
+		VMFunction *func = VCache.Find(tm.thing->GetClass(), VIndex, false);
 		if (func != nullptr)
 		{
 			GlobalVMStack.Call(func, params, 3, &ret, 1, nullptr);
@@ -1280,8 +1280,7 @@ bool PIT_CheckThing(FMultiBlockThingsIterator &it, FMultiBlockThingsIterator::Ch
 		params[2].i = true;
 
 		// re-get for the other actor.
-		clss = thing->GetClass();
-		func = clss->Virtuals.Size() > VIndex ? clss->Virtuals[VIndex] : nullptr;
+		func = VCache.Find(thing->GetClass(), VIndex, false);
 		if (func != nullptr)
 		{
 			GlobalVMStack.Call(func, params, 3, &ret, 1, nullptr);
@@ -599,6 +599,55 @@ void FBlockNode::Release ()
 //
 
 
+//===========================================================================
+//
+// FBlockIteratorSlot :: NewGeneration
+//
+// Claims a slot if the iterator doesn't have one yet and starts a new
+// visited set. Generation 0 is never handed out because that is what
+// freshly created actors and lines have in their stamps.
+//
+//===========================================================================
+
+unsigned FBlockIteratorSlot::UsedSlots;
+unsigned FBlockIteratorSlot::Generation;
+
+bool FBlockIteratorSlot::NewGeneration()
+{
+	if (disabled) return false;
+	if (slot < 0)
+	{
+		for (int i = 0; i < NUM_BLOCKITERATOR_SLOTS; i++)
+		{
+			if (!(UsedSlots & (1u << i)))
+			{
+				UsedSlots |= 1u << i;
+				slot = i;
+				break;
+			}
+		}
+		if (slot < 0) return false;
+	}
+	if (++Generation == 0) Generation = 1;
+	generation = Generation;
+	return true;
+}
+
+//===========================================================================
+//
+// FBlockIteratorSlot :: Release
+//
+//===========================================================================
+
+void FBlockIteratorSlot::Release()
+{
+	if (slot >= 0)
+	{
+		UsedSlots &= ~(1u << slot);
+		slot = -1;
+	}
+}
+
 //===========================================================================
 //
 // FBlockLinesIterator
@@ -606,9 +655,18 @@ void FBlockNode::Release ()
 //===========================================================================
 extern polyblock_t **PolyBlockMap;
 
-FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _maxy, bool keepvalidcount)
+FBlockLinesIterator::FBlockLinesIterator()
+{
+	minx = maxx = 0;
+	miny = maxy = 0;
+	if (!slot.NewGeneration()) validcount++;
+	list = NULL;
+	polyLink = NULL;
+}
+
+FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _maxy)
 {
-	if (!keepvalidcount) validcount++;
+	if (!slot.NewGeneration()) validcount++;
 	minx = _minx;
 	maxx = _maxx;
 	miny = _miny;
@@ -618,7 +676,7 @@ FBlockLinesIterator::FBlockLinesIterator(int _minx, int _miny, int _maxx, int _m
 
 void FBlockLinesIterator::init(const FBoundingBox &box)
 {
-	validcount++;
+	if (!slot.NewGeneration()) validcount++;
 	maxy = GetBlockY(box.Top());
 	miny = GetBlockY(box.Bottom());
 	maxx = GetBlockX(box.Right());
@@ -660,6 +718,19 @@ void FBlockLinesIterator::StartBlock(int x, int y)
 	}
 }
 
+//===========================================================================
+//
+// FBlockLinesIterator :: SwitchBlock
+//
+//===========================================================================
+
+void FBlockLinesIterator::SwitchBlock(int x, int y)
+{
+	minx = maxx = x;
+	miny = maxy = y;
+	StartBlock(x, y);
+}
+
 //===========================================================================
 //
 // FBlockLinesIterator :: Next
@@ -676,12 +747,11 @@ line_t *FBlockLinesIterator::Next()
 			{
 				if (polyIndex == 0)
 				{
-					if (polyLink->polyobj->validcount == validcount)
+					if (Visited(polyLink->polyobj))
 					{
 						polyLink = polyLink->next;
 						continue;
 					}
-					polyLink->polyobj->validcount = validcount;
 				}
 
 				line_t *ld = polyLink->polyobj->Linedefs[polyIndex];
@@ -692,13 +762,8 @@ line_t *FBlockLinesIterator::Next()
 					polyIndex = 0;
 				}
 
-				if (ld->validcount == validcount)
+				if (!Visited(ld))
 				{
-					continue;
-				}
-				else
-				{
-					ld->validcount = validcount;
 					return ld;
 				}
 			}
@@ -712,9 +777,8 @@ line_t *FBlockLinesIterator::Next()
 				line_t *ld = &lines[*list];
 
 				list++;
-				if (ld->validcount != validcount)
+				if (!Visited(ld))
 				{
-					ld->validcount = validcount;
 					return ld;
 				}
 			}
@@ -904,7 +968,7 @@ FBlockThingsIterator::FBlockThingsIterator()
 {
 	minx = maxx = 0;
 	miny = maxy = 0;
-	ClearHash();
+	if (!slot.NewGeneration()) ClearHash();
 	block = NULL;
 }
 
@@ -915,7 +979,7 @@ FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int
 	maxx = _maxx;
 	miny = _miny;
 	maxy = _maxy;
-	ClearHash();
+	if (!slot.NewGeneration()) ClearHash();
 	Reset();
 }
 
@@ -925,7 +989,7 @@ void FBlockThingsIterator::init(const FBoundingBox &box)
 	miny = GetBlockY(box.Bottom());
 	maxx = GetBlockX(box.Right());
 	minx = GetBlockX(box.Left());
-	ClearHash();
+	if (!slot.NewGeneration()) ClearHash();
 	Reset();
 }
 
@@ -1014,6 +1078,13 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 					return me;
 				}
 			}
+			else if (slot.Valid())
+			{
+				if (!slot.Visited(me->BlockIterStamps))
+				{
+					return me;
+				}
+			}
 			else
 			{
 				size_t hash = ((size_t)me >> 3) % countof(Buckets);
@@ -1070,9 +1141,10 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 //
 //===========================================================================
 
-FMultiBlockThingsIterator::FMultiBlockThingsIterator(FPortalGroupArray &check, AActor *origin, double checkradius, bool ignorerestricted)
+FMultiBlockThingsIterator::FMultiBlockThingsIterator(FPortalGroupArray &check, AActor *origin, double checkradius, bool ignorerestricted, bool noslot)
 	: checklist(check)
 {
+	if (noslot) blockIterator.slot.Disable();
 	checkpoint = origin->Pos();
 	if (!check.inited) P_CollectConnectedGroups(origin->Sector->PortalGroup, checkpoint, origin->Top(), checkradius, checklist);
 	checkpoint.Z = checkradius == -1? origin->radius : checkradius;
@@ -1080,9 +1152,10 @@ FMultiBlockThingsIterator::FMultiBlockThingsIterator(FPortalGroupArray &check, A
 	Reset();
 }
 
-FMultiBlockThingsIterator::FMultiBlockThingsIterator(FPortalGroupArray &check, double checkx, double checky, double checkz, double checkh, double checkradius, bool ignorerestricted, sector_t *newsec)
+FMultiBlockThingsIterator::FMultiBlockThingsIterator(FPortalGroupArray &check, double checkx, double checky, double checkz, double checkh, double checkradius, bool ignorerestricted, sector_t *newsec, bool noslot)
 	: checklist(check)
 {
+	if (noslot) blockIterator.slot.Disable();
 	checkpoint.X = checkx;
 	checkpoint.Y = checky;
 	checkpoint.Z = checkz;
@@ -1168,6 +1241,9 @@ void FMultiBlockThingsIterator::Reset()
 //
 // and the scriptable version
 //
+// Script iterators stay alive until they are collected, so they don't take
+// one of the iterator slots and use the hash instead.
+//
 //===========================================================================
 
 class DBlockThingsIterator : public DObject, public FMultiBlockThingsIterator
@@ -1184,7 +1260,7 @@ public:
 	}
 
 	DBlockThingsIterator(AActor *origin = nullptr, double checkradius = -1, bool ignorerestricted = false)
-		: FMultiBlockThingsIterator(check, origin, checkradius, ignorerestricted)
+		: FMultiBlockThingsIterator(check, origin, checkradius, ignorerestricted, true)
 	{
 		cres.thing = nullptr;
 		cres.Position.Zero();
@@ -1192,7 +1268,7 @@ public:
 	}
 
 	DBlockThingsIterator(double checkx, double checky, double checkz, double checkh, double checkradius, bool ignorerestricted, sector_t *newsec)
-		: FMultiBlockThingsIterator(check, checkx, checky, checkz, checkh, checkradius, ignorerestricted, newsec)
+		: FMultiBlockThingsIterator(check, checkx, checky, checkz, checkh, checkradius, ignorerestricted, newsec, true)
 	{
 		cres.thing = nullptr;
 		cres.Position.Zero();
@@ -1254,11 +1330,11 @@ TArray<intercept_t> FPathTraverse::intercepts(128);
 //
 //===========================================================================
 
-void FPathTraverse::AddLineIntercepts(int bx, int by)
+void FPathTraverse::AddLineIntercepts(int bx, int by, FBlockLinesIterator &it)
 {
-	FBlockLinesIterator it(bx, by, bx, by, true);
 	line_t *ld;
 
+	it.SwitchBlock(bx, by);
 	while ((ld = it.Next()))
 	{
 		int 				s1;
@@ -1629,13 +1705,14 @@ void FPathTraverse::init(double x1, double y1, double x2, double y2, int flags,
 
 	bool compatible = (flags & PT_COMPATIBLE) && (i_compatflags & COMPATF_HITSCAN);
 		
-	// we want to use one list of checked actors for the entire operation
+	// we want to use one list of checked lines and actors for the entire operation
+	FBlockLinesIterator btlit;
 	FBlockThingsIterator btit;
 	for (count = 0 ; count < 1000 ; count++)
 	{
 		if (flags & PT_ADDLINES)
 		{
-			AddLineIntercepts(mapx, mapy);
+			AddLineIntercepts(mapx, mapy, btlit);
 		}
 		
 		if (flags & PT_ADDTHINGS)
@@ -1679,8 +1756,8 @@ void FPathTraverse::init(double x1, double y1, double x2, double y2, int flags,
 			{
 				if (flags & PT_ADDLINES)
 				{
-					AddLineIntercepts(mapx + mapxstep, mapy);
-					AddLineIntercepts(mapx, mapy + mapystep);
+					AddLineIntercepts(mapx + mapxstep, mapy, btlit);
+					AddLineIntercepts(mapx, mapy + mapystep, btlit);
 				}
 				
 				if (flags & PT_ADDTHINGS)
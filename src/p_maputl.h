@@ -200,9 +200,59 @@ private:
 	TArray<WORD> data;
 };
 
+//============================================================================
+//
+// FBlockIteratorSlot
+//
+// Gives a blockmap iterator its own visited set. Each live iterator owns
+// one of the slots in FBlockIteratorStamps plus a generation number that
+// is unique to the current iteration, so checking for an already returned
+// object is a single compare and starting a new iteration clears nothing.
+// If all slots are taken, Valid() returns false and the iterator has to
+// fall back to validcount or its hash.
+//
+//============================================================================
+
+class FBlockIteratorSlot
+{
+	int slot;
+	unsigned generation;
+	bool disabled;
+
+	static unsigned UsedSlots;
+	static unsigned Generation;
+
+	FBlockIteratorSlot(const FBlockIteratorSlot &) = delete;
+	FBlockIteratorSlot &operator=(const FBlockIteratorSlot &) = delete;
+
+public:
+	FBlockIteratorSlot() : slot(-1), generation(0), disabled(false) {}
+	~FBlockIteratorSlot() { Release(); }
+
+	bool NewGeneration();
+	void Release();
+	bool Valid() const { return slot >= 0; }
+
+	// For iterators whose lifetime is not bounded by the caller, like the
+	// scripted ones which live until the next garbage collection. They
+	// would otherwise keep a slot that native iterators need.
+	void Disable() { Release(); disabled = true; }
+
+	// Returns true if the object was already seen in this generation and marks it as seen otherwise.
+	bool Visited(FBlockIteratorStamps &stamps)
+	{
+		unsigned &stamp = stamps.Stamp[slot];
+		if (stamp == generation) return true;
+		stamp = generation;
+		return false;
+	}
+};
+
 class FBlockLinesIterator
 {
 	friend class FMultiBlockLinesIterator;
+	friend class FPathTraverse;
+	friend class FLinePortalTraverse;
 	int minx, maxx;
 	int miny, maxy;
 
@@ -210,13 +260,23 @@ class FBlockLinesIterator
 	polyblock_t *polyLink;
 	int polyIndex;
 	int *list;
+	FBlockIteratorSlot slot;
 
 	void StartBlock(int x, int y);
+	void SwitchBlock(int x, int y);
+
+	template<class T> bool Visited(T *obj)
+	{
+		if (slot.Valid()) return slot.Visited(obj->BlockIterStamps);
+		if (obj->validcount == validcount) return true;
+		obj->validcount = validcount;
+		return false;
+	}
 
-	FBlockLinesIterator() {}
+	FBlockLinesIterator();
 	void init(const FBoundingBox &box);
 public:
-	FBlockLinesIterator(int minx, int miny, int maxx, int maxy, bool keepvalidcount = false);
+	FBlockLinesIterator(int minx, int miny, int maxx, int maxy);
 	FBlockLinesIterator(const FBoundingBox &box);
 	line_t *Next();
 	void Reset() { StartBlock(minx, miny); }
@@ -279,7 +339,9 @@ class FBlockThingsIterator
 	int curx, cury;
 
 	FBlockNode *block;
+	FBlockIteratorSlot slot;
 
+	// Only used if no iterator slot is available.
 	int Buckets[32];
 
 	struct HashEntry
@@ -336,8 +398,8 @@ public:
 		int portalflags;
 	};
 
-	FMultiBlockThingsIterator(FPortalGroupArray &check, AActor *origin, double checkradius = -1, bool ignorerestricted = false);
-	FMultiBlockThingsIterator(FPortalGroupArray &check, double checkx, double checky, double checkz, double checkh, double checkradius, bool ignorerestricted, sector_t *newsec);
+	FMultiBlockThingsIterator(FPortalGroupArray &check, AActor *origin, double checkradius = -1, bool ignorerestricted = false, bool noslot = false);
+	FMultiBlockThingsIterator(FPortalGroupArray &check, double checkx, double checky, double checkz, double checkh, double checkradius, bool ignorerestricted, sector_t *newsec, bool noslot = false);
 	bool Next(CheckResult *item);
 	void Reset();
 	const FBoundingBox &Box() const
@@ -359,7 +421,7 @@ protected:
 	unsigned int intercept_count;
 	unsigned int count;
 
-	virtual void AddLineIntercepts(int bx, int by);
+	virtual void AddLineIntercepts(int bx, int by, FBlockLinesIterator &it);
 	virtual void AddThingIntercepts(int bx, int by, FBlockThingsIterator &it, bool compatible);
 	FPathTraverse() {}
 public:
@@ -396,7 +458,7 @@ public:
 
 class FLinePortalTraverse : public FPathTraverse
 {
-	void AddLineIntercepts(int bx, int by);
+	void AddLineIntercepts(int bx, int by, FBlockLinesIterator &it);
 
 public:
 	FLinePortalTraverse()
@@ -1496,7 +1496,7 @@ DEFINE_ACTION_FUNCTION(AActor, Touch)
 
 void AActor::CallTouch(AActor *toucher)
 {
-	IFVIRTUAL(AActor, Touch)
+	IFOVERRIDENVIRTUAL(AActor, Touch)
 	{
 		VMValue params[2] = { (DObject*)this, toucher };
 		GlobalVMStack.Call(func, params, 2, nullptr, 0, nullptr);
@@ -3430,7 +3430,7 @@ DEFINE_ACTION_FUNCTION(AActor, Slam)
 
 bool AActor::CallSlam(AActor *thing)
 {
-	IFVIRTUAL(AActor, Slam)
+	IFOVERRIDENVIRTUAL(AActor, Slam)
 	{
 		VMValue params[2] = { (DObject*)this, thing };
 		VMReturn ret;
@@ -4777,7 +4777,7 @@ DEFINE_ACTION_FUNCTION(AActor, BeginPlay)
 
 void AActor::CallBeginPlay()
 {
-	IFVIRTUAL(AActor, BeginPlay)
+	IFOVERRIDENVIRTUAL(AActor, BeginPlay)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[1] = { (DObject*)this };
@@ -4858,7 +4858,7 @@ DEFINE_ACTION_FUNCTION(AActor, Activate)
 
 void AActor::CallActivate(AActor *activator)
 {
-	IFVIRTUAL(AActor, Activate)
+	IFOVERRIDENVIRTUAL(AActor, Activate)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[2] = { (DObject*)this, (DObject*)activator };
@@ -4904,7 +4904,7 @@ DEFINE_ACTION_FUNCTION(AActor, Deactivate)
 
 void AActor::CallDeactivate(AActor *activator)
 {
-	IFVIRTUAL(AActor, Deactivate)
+	IFOVERRIDENVIRTUAL(AActor, Deactivate)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[2] = { (DObject*)this, (DObject*)activator };
@@ -7077,7 +7077,7 @@ DEFINE_ACTION_FUNCTION(AActor, DoSpecialDamage)
 
 int AActor::CallDoSpecialDamage(AActor *target, int damage, FName damagetype)
 {
-	IFVIRTUAL(AActor, DoSpecialDamage)
+	IFOVERRIDENVIRTUAL(AActor, DoSpecialDamage)
 	{
 		// Without the type cast this picks the 'void *' assignment...
 		VMValue params[4] = { (DObject*)this, (DObject*)target, damage, damagetype.GetIndex() };
@@ -7143,7 +7143,7 @@ DEFINE_ACTION_FUNCTION(AActor, TakeSpecialDamage)
 
 int AActor::CallTakeSpecialDamage(AActor *inflictor, AActor *source, int damage, FName damagetype)
 {
-	IFVIRTUAL(AActor, TakeSpecialDamage)
+	IFOVERRIDENVIRTUAL(AActor, TakeSpecialDamage)
 	{
 		VMValue params[5] = { (DObject*)this, inflictor, source, damage, damagetype.GetIndex() };
 		VMReturn ret;
@@ -7589,42 +7589,67 @@ DEFINE_ACTION_FUNCTION(AActor, absangle)	// should this be global?
 	ACTION_RETURN_FLOAT(absangle(DAngle(a1), DAngle(a2)).Degrees);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Distance2D)
+static double Actor_Distance2D(AActor *self, AActor *other)
+{
+	return self->Distance2D(PARAM_NULLCHECK(other, other));
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, Distance2D, Actor_Distance2D)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT_NOT_NULL(other, AActor);
 	ACTION_RETURN_FLOAT(self->Distance2D(other));
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Distance3D)
+static double Actor_Distance3D(AActor *self, AActor *other)
+{
+	return self->Distance3D(PARAM_NULLCHECK(other, other));
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, Distance3D, Actor_Distance3D)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT_NOT_NULL(other, AActor);
 	ACTION_RETURN_FLOAT(self->Distance3D(other));
 }
 
-DEFINE_ACTION_FUNCTION(AActor, AddZ)
+static void Actor_AddZ(AActor *self, double addz, bool moving)
+{
+	self->AddZ(addz, moving);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, AddZ, Actor_AddZ)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_FLOAT(addz);
 	PARAM_BOOL_DEF(moving);
-	self->AddZ(addz, moving);
+	Actor_AddZ(self, addz, moving);
 	return 0;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, SetZ)
+static void Actor_SetZ(AActor *self, double z)
+{
+	self->SetZ(z);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, SetZ, Actor_SetZ)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_FLOAT(z);
-	self->SetZ(z);
+	Actor_SetZ(self, z);
 	return 0;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, SetDamage)
+static void Actor_SetDamage(AActor *self, int dmg)
+{
+	self->SetDamage(dmg);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, SetDamage, Actor_SetDamage)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_INT(dmg);
-	self->SetDamage(dmg);
+	Actor_SetDamage(self, dmg);
 	return 0;
 }
 
@@ -7635,11 +7660,16 @@ DEFINE_ACTION_FUNCTION(AActor, GetDefaultByType)
 	ACTION_RETURN_OBJECT(cls == nullptr? nullptr : GetDefaultByType(cls));
 }
 
-DEFINE_ACTION_FUNCTION(AActor, GetBobOffset)
+static double Actor_GetBobOffset(AActor *self, double frac)
+{
+	return self->GetBobOffset(frac);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, GetBobOffset, Actor_GetBobOffset)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_FLOAT_DEF(frac);
-	ACTION_RETURN_FLOAT(self->GetBobOffset(frac));
+	ACTION_RETURN_FLOAT(Actor_GetBobOffset(self, frac));
 }
 
 // This combines all 3 variations of the internal function
@@ -696,7 +696,7 @@ double sector_t::FindLowestCeilingPoint (vertex_t **v) const
 void sector_t::SetColor(int r, int g, int b, int desat)
 {
 	PalEntry color = PalEntry (r,g,b);
-	ColorMap = GetSpecialLights (color, ColorMap->Fade, desat);
+	ColorMap = GetSpecialLights (color, ColorMap->Fade, desat, true);
 	P_RecalculateAttachedLights(this);
 }
 
@@ -705,7 +705,7 @@ DEFINE_ACTION_FUNCTION(_Sector, SetColor)
 	PARAM_SELF_STRUCT_PROLOGUE(sector_t);
 	PARAM_COLOR(color);
 	PARAM_INT(desat);
-	self->ColorMap = GetSpecialLights(color, self->ColorMap->Fade, desat);
+	self->ColorMap = GetSpecialLights(color, self->ColorMap->Fade, desat, true);
 	P_RecalculateAttachedLights(self);
 	return 0;
 }
@@ -713,7 +713,7 @@ DEFINE_ACTION_FUNCTION(_Sector, SetColor)
 void sector_t::SetFade(int r, int g, int b)
 {
 	PalEntry fade = PalEntry (r,g,b);
-	ColorMap = GetSpecialLights (ColorMap->Color, fade, ColorMap->Desaturate);
+	ColorMap = GetSpecialLights (ColorMap->Color, fade, ColorMap->Desaturate, true);
 	P_RecalculateAttachedLights(this);
 }
 
@@ -721,7 +721,7 @@ DEFINE_ACTION_FUNCTION(_Sector, SetFade)
 {
 	PARAM_SELF_STRUCT_PROLOGUE(sector_t);
 	PARAM_COLOR(fade);
-	self->ColorMap = GetSpecialLights(self->ColorMap->Color, fade, self->ColorMap->Desaturate);
+	self->ColorMap = GetSpecialLights(self->ColorMap->Color, fade, self->ColorMap->Desaturate, true);
 	P_RecalculateAttachedLights(self);
 	return 0;
 }
@@ -25,6 +25,7 @@
 
 #include <math.h>
 #include <float.h>
+#include <thread>
 #ifdef _MSC_VER
 #include <malloc.h>		// for alloca()
 #endif
@@ -73,6 +74,7 @@
 #include "p_blockmap.h"
 #include "r_utility.h"
 #include "p_spec.h"
+#include "memarena.h"
 #ifndef NO_EDATA
 #include "edata.h"
 #endif
@@ -103,6 +105,7 @@ CVAR (Bool, genblockmap, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, gennodes, false, CVAR_SERVERINFO|CVAR_GLOBALCONFIG);
 CVAR (Bool, genglnodes, false, CVAR_SERVERINFO);
 CVAR (Bool, showloadtimes, false, 0);
+CVAR (Bool, prefetchmaps, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 
 static void P_Shutdown ();
 
@@ -251,6 +254,201 @@ static int GetMapIndex(const char *mapname, int lastindex, const char *lumpname,
 	return -1;	// End of map reached
 }
 
+//===========================================================================
+//
+// Map lump prefetching
+//
+// This is an I/O prefetch only: while the intermission is showing, a
+// worker thread reads the raw lumps of the next map into memory so that
+// P_SetupLevel does not have to wait for the disk. Nothing is parsed or
+// built in advance; P_SetupLevel still does all of that work.
+//
+// Only lumps that are stored uncompressed in a real file are handled. The
+// worker opens its own FILE for them and touches nothing else, so it can
+// run alongside the game without any locking. The data is only copied
+// out after the thread has been joined.
+//
+//===========================================================================
+
+struct FMapPrefetch
+{
+	FString MapName;
+	TArray<int> Lumps;
+	TArray<FString> Files;
+	TArray<int> Offsets;
+	TArray<unsigned> Sizes;
+	TArray< TArray<BYTE> > Data;
+	std::thread Thread;
+	cycle_t ReadTime;
+};
+
+static FMapPrefetch MapPrefetch;
+
+static void P_PrefetchThreadProc(FMapPrefetch *prefetch)
+{
+	prefetch->ReadTime.Clock();
+	for (unsigned i = 0; i < prefetch->Lumps.Size(); i++)
+	{
+		FILE *f = fopen(prefetch->Files[i], "rb");
+		if (f != NULL)
+		{
+			TArray<BYTE> &data = prefetch->Data[i];
+			data.Resize(prefetch->Sizes[i]);
+			if (fseek(f, prefetch->Offsets[i], SEEK_SET) != 0 ||
+				fread(&data[0], 1, data.Size(), f) != data.Size())
+			{
+				data.Clear();
+			}
+			fclose(f);
+		}
+	}
+	prefetch->ReadTime.Unclock();
+}
+
+static void P_AddPrefetchLump(int lump)
+{
+	if (lump < 0 || lump >= Wads.GetNumLumps() || Wads.LumpLength(lump) <= 0 ||
+		!Wads.IsUncompressedFile(lump) || Wads.IsEncryptedFile(lump))
+	{
+		return;
+	}
+	MapPrefetch.Lumps.Push(lump);
+	MapPrefetch.Files.Push(Wads.GetWadFullName(Wads.GetLumpFile(lump)));
+	MapPrefetch.Offsets.Push(Wads.GetLumpOffset(lump));
+	MapPrefetch.Sizes.Push((unsigned)Wads.LumpLength(lump));
+}
+
+//===========================================================================
+//
+// P_PrefetchMapLumps
+//
+// Starts reading the given map's lumps in the background. This mirrors
+// the lump search in P_OpenMapData for maps stored directly in a WAD;
+// anything else is simply loaded the normal way later.
+//
+//===========================================================================
+
+void P_PrefetchMapLumps(const char *mapname)
+{
+	P_ClearMapPrefetch();
+
+	if (!prefetchmaps || strlen(mapname) > 8)
+	{
+		return;
+	}
+
+	FString fmt;
+	int lump_name = Wads.CheckNumForName(mapname);
+	fmt.Format("maps/%s.wad", mapname);
+	int lump_wad = Wads.CheckNumForFullName(fmt);
+	fmt.Format("maps/%s.map", mapname);
+	int lump_map = Wads.CheckNumForFullName(fmt);
+
+	if (lump_name < 0 || lump_name < lump_wad || lump_name < lump_map ||
+		lump_name + 1 >= Wads.GetNumLumps() || Wads.GetLumpFile(lump_name) != Wads.GetLumpFile(lump_name + 1))
+	{
+		return;
+	}
+
+	int wadfile = Wads.GetLumpFile(lump_name);
+	bool textmap = !stricmp(Wads.GetLumpFullName(lump_name + 1), "TEXTMAP");
+	int index = 0;
+
+	P_AddPrefetchLump(lump_name);
+	for (int i = lump_name + 1; i < Wads.GetNumLumps() && Wads.GetLumpFile(i) == wadfile; i++)
+	{
+		const char *lumpname = Wads.GetLumpFullName(i);
+		if (textmap)
+		{
+			if (!stricmp(lumpname, "ENDMAP")) break;
+		}
+		else
+		{
+			index = GetMapIndex(mapname, index, lumpname, false);
+			if (index < 0) break;
+		}
+		P_AddPrefetchLump(i);
+	}
+
+	// GL nodes stored in the same WAD.
+	fmt.Format("GL_%s", mapname);
+	if (fmt.Len() <= 8)
+	{
+		int gllabel = Wads.CheckNumForName(fmt, ns_global, wadfile);
+		if (gllabel >= 0)
+		{
+			for (int i = 1; i <= 4; i++)
+			{
+				P_AddPrefetchLump(gllabel + i);
+			}
+		}
+	}
+
+	if (MapPrefetch.Lumps.Size() > 0)
+	{
+		MapPrefetch.MapName = mapname;
+		MapPrefetch.Data.Resize(MapPrefetch.Lumps.Size());
+		MapPrefetch.ReadTime.Reset();
+		MapPrefetch.Thread = std::thread(P_PrefetchThreadProc, &MapPrefetch);
+	}
+}
+
+//===========================================================================
+//
+// P_ClearMapPrefetch
+//
+// Waits for the worker thread and throws away everything it has read.
+//
+//===========================================================================
+
+void P_ClearMapPrefetch()
+{
+	if (MapPrefetch.Thread.joinable())
+	{
+		MapPrefetch.Thread.join();
+	}
+	MapPrefetch.MapName = "";
+	MapPrefetch.Lumps.Clear();
+	MapPrefetch.Files.Clear();
+	MapPrefetch.Offsets.Clear();
+	MapPrefetch.Sizes.Clear();
+	MapPrefetch.Data.Clear();
+}
+
+//===========================================================================
+//
+// P_OpenMapLump
+//
+// Returns a reader for one of a map's lumps, served from the prefetched
+// data if the lump has been read in the background.
+//
+//===========================================================================
+
+FileReader *P_OpenMapLump(int lump)
+{
+	if (MapPrefetch.Lumps.Size() > 0)
+	{
+		unsigned index = MapPrefetch.Lumps.Find(lump);
+		if (index < MapPrefetch.Lumps.Size())
+		{
+			if (MapPrefetch.Thread.joinable())
+			{
+				MapPrefetch.Thread.join();
+				if (showloadtimes)
+				{
+					Printf ("Prefetched lumps of %s in %.4f ms\n", MapPrefetch.MapName.GetChars(), MapPrefetch.ReadTime.TimeMS());
+				}
+			}
+			TArray<BYTE> &data = MapPrefetch.Data[index];
+			if (data.Size() == MapPrefetch.Sizes[index])
+			{
+				return new MemoryArrayReader((const char *)&data[0], data.Size());
+			}
+		}
+	}
+	return Wads.ReopenLumpNum(lump);
+}
+
 //===========================================================================
 //
 // Opens a map for reading
@@ -301,7 +499,7 @@ MapData *P_OpenMapData(const char * mapname, bool justcheck)
 			{
 				// The following lump is from a different file so whatever this is,
 				// it is not a multi-lump Doom level so let's assume it is a Build map.
-				map->MapLumps[0].Reader = map->file = Wads.ReopenLumpNum(lump_name);
+				map->MapLumps[0].Reader = map->file = P_OpenMapLump(lump_name);
 				if (!P_IsBuildMap(map))
 				{
 					delete map;
@@ -312,7 +510,7 @@ MapData *P_OpenMapData(const char * mapname, bool justcheck)
 
 			// This case can only happen if the lump is inside a real WAD file.
 			// As such any special handling for other types of lumps is skipped.
-			map->MapLumps[0].Reader = map->file = Wads.ReopenLumpNum(lump_name);
+			map->MapLumps[0].Reader = map->file = P_OpenMapLump(lump_name);
 			strncpy(map->MapLumps[0].Name, Wads.GetLumpFullName(lump_name), 8);
 			map->Encrypted = Wads.IsEncryptedFile(lump_name);
 			map->InWad = true;
@@ -355,14 +553,14 @@ MapData *P_OpenMapData(const char * mapname, bool justcheck)
 					// The next lump is not part of this map anymore
 					if (index < 0) break;
 
-					map->MapLumps[index].Reader = Wads.ReopenLumpNum(lump_name + i);
+					map->MapLumps[index].Reader = P_OpenMapLump(lump_name + i);
 					strncpy(map->MapLumps[index].Name, lumpname, 8);
 				}
 			}
 			else
 			{
 				map->isText = true;
-				map->MapLumps[1].Reader = Wads.ReopenLumpNum(lump_name + 1);
+				map->MapLumps[1].Reader = P_OpenMapLump(lump_name + 1);
 				for(int i = 2;; i++)
 				{
 					const char * lumpname = Wads.GetLumpFullName(lump_name + i);
@@ -398,7 +596,7 @@ MapData *P_OpenMapData(const char * mapname, bool justcheck)
 						break;
 					}
 					else continue;
-					map->MapLumps[index].Reader = Wads.ReopenLumpNum(lump_name + i);
+					map->MapLumps[index].Reader = P_OpenMapLump(lump_name + i);
 					strncpy(map->MapLumps[index].Name, lumpname, 8);
 				}
 			}
@@ -1475,7 +1673,7 @@ void P_LoadSectors (MapData *map, FMissingTextureTracker &missingtex)
 	int					lumplen = map->Size(ML_SECTORS);
 
 	numsectors = lumplen / sizeof(mapsector_t);
-	sectors = new sector_t[numsectors];		
+	sectors = P_AllocLevelArray<sector_t>(numsectors);
 	memset (sectors, 0, numsectors*sizeof(sector_t));
 
 	if (level.flags & LEVEL_SNDSEQTOTALCTRL)
@@ -1491,7 +1689,7 @@ void P_LoadSectors (MapData *map, FMissingTextureTracker &missingtex)
 	ss = sectors;
 	
 	// Extended properties
-	sectors[0].e = new extsector_t[numsectors];
+	sectors[0].e = P_AllocLevelArray<extsector_t>(numsectors);
 
 	for (i = 0; i < numsectors; i++, ss++, ms++)
 	{
@@ -2107,7 +2305,7 @@ void P_LoadLineDefs (MapData * map)
 	maplinedef_t *mld;
 		
 	numlines = lumplen / sizeof(maplinedef_t);
-	lines = new line_t[numlines];
+	lines = P_AllocLevelArray<line_t>(numlines);
 	linemap.Resize(numlines);
 	memset (lines, 0, numlines*sizeof(line_t));
 
@@ -2206,7 +2404,7 @@ void P_LoadLineDefs2 (MapData * map)
 	maplinedef2_t *mld;
 		
 	numlines = lumplen / sizeof(maplinedef2_t);
-	lines = new line_t[numlines];
+	lines = P_AllocLevelArray<line_t>(numlines);
 	linemap.Resize(numlines);
 	memset (lines, 0, numlines*sizeof(line_t));
 
@@ -2307,7 +2505,7 @@ static void P_AllocateSideDefs (int count)
 {
 	int i;
 
-	sides = new side_t[count];
+	sides = P_AllocLevelArray<side_t>(count);
 	memset (sides, 0, count*sizeof(side_t));
 
 	sidetemp = new sidei_t[MAX(count,numvertexes)];
@@ -2677,32 +2875,23 @@ void P_LoadSideDefs2 (MapData *map, FMissingTextureTracker &missingtex)
 // as possible from its ZDBSP incarnation.
 //
 
-static unsigned int BlockHash (TArray<int> *block)
+static unsigned int BlockHash (const int *ar, unsigned int size)
 {
 	int hash = 0;
-	int *ar = &(*block)[0];
-	for (size_t i = 0; i < block->Size(); ++i)
+	for (unsigned int i = 0; i < size; ++i)
 	{
 		hash = hash * 12235 + ar[i];
 	}
 	return hash & 0x7fffffff;
 }
 
-static bool BlockCompare (TArray<int> *block1, TArray<int> *block2)
+static bool BlockCompare (const int *ar1, unsigned int size1, const int *ar2, unsigned int size2)
 {
-	size_t size = block1->Size();
-
-	if (size != block2->Size())
+	if (size1 != size2)
 	{
 		return false;
 	}
-	if (size == 0)
-	{
-		return true;
-	}
-	int *ar1 = &(*block1)[0];
-	int *ar2 = &(*block2)[0];
-	for (size_t i = 0; i < size; ++i)
+	for (unsigned int i = 0; i < size1; ++i)
 	{
 		if (ar1[i] != ar2[i])
 		{
@@ -2712,16 +2901,17 @@ static bool BlockCompare (TArray<int> *block1, TArray<int> *block2)
 	return true;
 }
 
-static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, int bmapwidth, int bmapheight)
+// The block lists are stored back to back in BlockLines; the list for
+// block i runs from BlockStarts[i] up to BlockStarts[i+1].
+static void CreatePackedBlockmap (TArray<int> &BlockMap, const TArray<int> &BlockStarts, const TArray<int> &BlockLines, int bmapwidth, int bmapheight)
 {
 	int buckets[4096];
 	int *hashes, hashblock;
-	TArray<int> *block;
 	int zero = 0;
 	int terminator = -1;
-	int *array;
 	int i, hash;
 	int hashed = 0, nothashed = 0;
+	const int *lineptr = BlockLines.Size() > 0 ? &BlockLines[0] : NULL;
 
 	hashes = new int[bmapwidth * bmapheight];
 
@@ -2730,12 +2920,14 @@ static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, in
 
 	for (i = 0; i < bmapwidth * bmapheight; ++i)
 	{
-		block = &blocks[i];
-		hash = BlockHash (block) % 4096;
+		const int *array = lineptr + BlockStarts[i];
+		unsigned int size = BlockStarts[i+1] - BlockStarts[i];
+
+		hash = BlockHash (array, size) % 4096;
 		hashblock = buckets[hash];
 		while (hashblock != -1)
 		{
-			if (BlockCompare (block, &blocks[hashblock]))
+			if (BlockCompare (array, size, lineptr + BlockStarts[hashblock], BlockStarts[hashblock+1] - BlockStarts[hashblock]))
 			{
 				break;
 			}
@@ -2752,10 +2944,10 @@ static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, in
 			buckets[hash] = i;
 			BlockMap[4+i] = BlockMap.Size ();
 			BlockMap.Push (zero);
-			array = &(*block)[0];
-			for (size_t j = 0; j < block->Size(); ++j)
+			unsigned int pos = BlockMap.Reserve (size);
+			if (size > 0)
 			{
-				BlockMap.Push (array[j]);
+				memcpy (&BlockMap[pos], array, size * sizeof(int));
 			}
 			BlockMap.Push (terminator);
 			nothashed++;
@@ -2770,9 +2962,205 @@ static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, in
 #define BLOCKBITS 7
 #define BLOCKSIZE 128
 
-static void P_CreateBlockMap ()
+// Block rows are split into bands that are filled on separate threads.
+#define MAX_BLOCKMAP_BANDS		8
+#define MIN_BLOCKMAP_BAND_ROWS	16
+
+//==========================================================================
+//
+// RasterizeBlockLine
+//
+// Calls emit for every block a line passes through, in the order the
+// blocks are visited when walking from v1 to v2.
+//
+//==========================================================================
+
+template<class Func>
+static void RasterizeBlockLine (int x1, int y1, int x2, int y2, int minx, int miny, int bmapwidth, Func emit)
+{
+	int dx = x2 - x1;
+	int dy = y2 - y1;
+	int bx = (x1 - minx) >> BLOCKBITS;
+	int by = (y1 - miny) >> BLOCKBITS;
+	int bx2 = (x2 - minx) >> BLOCKBITS;
+	int by2 = (y2 - miny) >> BLOCKBITS;
+
+	int block = bx + by * bmapwidth;
+	int endblock = bx2 + by2 * bmapwidth;
+
+	if (block == endblock)	// Single block
+	{
+		emit (block);
+	}
+	else if (by == by2)		// Horizontal line
+	{
+		if (bx > bx2)
+		{
+			swapvalues (block, endblock);
+		}
+		do
+		{
+			emit (block);
+			block += 1;
+		} while (block <= endblock);
+	}
+	else if (bx == bx2)	// Vertical line
+	{
+		if (by > by2)
+		{
+			swapvalues (block, endblock);
+		}
+		do
+		{
+			emit (block);
+			block += bmapwidth;
+		} while (block <= endblock);
+	}
+	else				// Diagonal line
+	{
+		int xchange = (dx < 0) ? -1 : 1;
+		int ychange = (dy < 0) ? -1 : 1;
+		int ymove = ychange * bmapwidth;
+		int adx = abs (dx);
+		int ady = abs (dy);
+
+		if (adx == ady)		// 45 degrees
+		{
+			int xb = (x1 - minx) & (BLOCKSIZE-1);
+			int yb = (y1 - miny) & (BLOCKSIZE-1);
+			if (dx < 0)
+			{
+				xb = BLOCKSIZE-xb;
+			}
+			if (dy < 0)
+			{
+				yb = BLOCKSIZE-yb;
+			}
+			if (xb < yb)
+				adx--;
+		}
+		if (adx >= ady)		// X-major
+		{
+			int yadd = dy < 0 ? -1 : BLOCKSIZE;
+			do
+			{
+				int stop = (Scale ((by << BLOCKBITS) + yadd - (y1 - miny), dx, dy) + (x1 - minx)) >> BLOCKBITS;
+				while (bx != stop)
+				{
+					emit (block);
+					block += xchange;
+					bx += xchange;
+				}
+				emit (block);
+				block += ymove;
+				by += ychange;
+			} while (by != by2);
+			while (block != endblock)
+			{
+				emit (block);
+				block += xchange;
+			}
+			emit (block);
+		}
+		else					// Y-major
+		{
+			int xadd = dx < 0 ? -1 : BLOCKSIZE;
+			do
+			{
+				int stop = (Scale ((bx << BLOCKBITS) + xadd - (x1 - minx), dy, dx) + (y1 - miny)) >> BLOCKBITS;
+				while (by != stop)
+				{
+					emit (block);
+					block += ymove;
+					by += ychange;
+				}
+				emit (block);
+				block += xchange;
+				bx += xchange;
+			} while (bx != bx2);
+			while (block != endblock)
+			{
+				emit (block);
+				block += ymove;
+			}
+			emit (block);
+		}
+	}
+}
+
+//==========================================================================
+//
+// A horizontal band of block rows and the block lists collected for it.
+// Every band walks all lines in order and keeps only the blocks inside
+// itself, so each list ends up sorted by line number just like a serial
+// build would produce.
+//
+//==========================================================================
+
+struct FBlockLine
+{
+	int x1, y1, x2, y2;
+	int minrow, maxrow;
+};
+
+struct FBlockBand
+{
+	int FirstRow, NumRows;
+	TArray<int> Starts;		// NumRows*bmapwidth + 1 entries, relative to Lines
+	TArray<int> Lines;
+};
+
+static void FillBlockBand (FBlockBand *band, const FBlockLine *blines, int count, int minx, int miny, int bmapwidth)
+{
+	int firstblock = band->FirstRow * bmapwidth;
+	int numblocks = band->NumRows * bmapwidth;
+	int lastrow = band->FirstRow + band->NumRows - 1;
+	TArray<int> hitblocks, hitlines;
+
+	for (int line = 0; line < count; ++line)
+	{
+		const FBlockLine &bl = blines[line];
+		if (bl.maxrow < band->FirstRow || bl.minrow > lastrow)
+		{
+			continue;
+		}
+		RasterizeBlockLine (bl.x1, bl.y1, bl.x2, bl.y2, minx, miny, bmapwidth, [&](int block)
+		{
+			block -= firstblock;
+			if ((unsigned)block < (unsigned)numblocks)
+			{
+				hitblocks.Push (block);
+				hitlines.Push (line);
+			}
+		});
+	}
+
+	// Counting sort by block; it is stable so the line order is kept.
+	band->Starts.Resize (numblocks + 1);
+	memset (&band->Starts[0], 0, band->Starts.Size() * sizeof(int));
+	for (unsigned int i = 0; i < hitblocks.Size(); ++i)
+	{
+		band->Starts[hitblocks[i] + 1]++;
+	}
+	for (int i = 0; i < numblocks; ++i)
+	{
+		band->Starts[i + 1] += band->Starts[i];
+	}
+	TArray<int> fill;
+	fill.Resize (numblocks);
+	if (numblocks > 0)
+	{
+		memcpy (&fill[0], &band->Starts[0], numblocks * sizeof(int));
+	}
+	band->Lines.Resize (hitlines.Size());
+	for (unsigned int i = 0; i < hitlines.Size(); ++i)
+	{
+		band->Lines[fill[hitblocks[i]]++] = hitlines[i];
+	}
+}
+
+static int P_CreateBlockMap ()
 {
-	TArray<int> *BlockLists, *block, *endblock;
 	int adder;
 	int bmapwidth, bmapheight;
 	double dminx, dmaxx, dminy, dmaxy;
@@ -2781,7 +3169,7 @@ static void P_CreateBlockMap ()
 	int line;
 
 	if (numvertexes <= 0)
-		return;
+		return 0;
 
 	// Find map extents for the blockmap
 	dminx = dmaxx = vertexes[0].fX();
@@ -2810,133 +3198,67 @@ static void P_CreateBlockMap ()
 	adder = bmapwidth;		BlockMap.Push (adder);
 	adder = bmapheight;		BlockMap.Push (adder);
 
-	BlockLists = new TArray<int>[bmapwidth * bmapheight];
-
+	TArray<FBlockLine> BlockLines;
+	BlockLines.Resize (numlines);
 	for (line = 0; line < numlines; ++line)
 	{
-		int x1 = int(lines[line].v1->fX());
-		int y1 = int(lines[line].v1->fY());
-		int x2 = int(lines[line].v2->fX());
-		int y2 = int(lines[line].v2->fY());
-		int dx = x2 - x1;
-		int dy = y2 - y1;
-		int bx = (x1 - minx) >> BLOCKBITS;
-		int by = (y1 - miny) >> BLOCKBITS;
-		int bx2 = (x2 - minx) >> BLOCKBITS;
-		int by2 = (y2 - miny) >> BLOCKBITS;
+		FBlockLine &bl = BlockLines[line];
+		bl.x1 = int(lines[line].v1->fX());
+		bl.y1 = int(lines[line].v1->fY());
+		bl.x2 = int(lines[line].v2->fX());
+		bl.y2 = int(lines[line].v2->fY());
+		bl.minrow = (MIN(bl.y1, bl.y2) - miny) >> BLOCKBITS;
+		bl.maxrow = (MAX(bl.y1, bl.y2) - miny) >> BLOCKBITS;
+	}
+
+	int numbands = clamp<int>(std::thread::hardware_concurrency(), 1, MAX_BLOCKMAP_BANDS);
+	numbands = clamp(bmapheight / MIN_BLOCKMAP_BAND_ROWS, 1, numbands);
 
-		block = &BlockLists[bx + by * bmapwidth];
-		endblock = &BlockLists[bx2 + by2 * bmapwidth];
+	FBlockBand bands[MAX_BLOCKMAP_BANDS];
+	std::thread threads[MAX_BLOCKMAP_BANDS];
+	const FBlockLine *blines = numlines > 0 ? &BlockLines[0] : NULL;
+
+	for (i = 0; i < numbands; ++i)
+	{
+		bands[i].FirstRow = bmapheight * i / numbands;
+		bands[i].NumRows = bmapheight * (i + 1) / numbands - bands[i].FirstRow;
+	}
+	for (i = 1; i < numbands; ++i)
+	{
+		threads[i] = std::thread (FillBlockBand, &bands[i], blines, numlines, minx, miny, bmapwidth);
+	}
+	FillBlockBand (&bands[0], blines, numlines, minx, miny, bmapwidth);
+	for (i = 1; i < numbands; ++i)
+	{
+		threads[i].join();
+	}
 
-		if (block == endblock)	// Single block
+	// Stitch the bands together into one set of flat arrays.
+	TArray<int> BlockStarts (bmapwidth * bmapheight + 1);
+	TArray<int> BlockLists;
+	for (i = 0; i < numbands; ++i)
+	{
+		int base = BlockLists.Size();
+		int numblocks = bands[i].NumRows * bmapwidth;
+		for (int j = 0; j < numblocks; ++j)
 		{
-			block->Push (line);
+			BlockStarts.Push (base + bands[i].Starts[j]);
 		}
-		else if (by == by2)		// Horizontal line
+		unsigned int pos = BlockLists.Reserve (bands[i].Lines.Size());
+		if (bands[i].Lines.Size() > 0)
 		{
-			if (bx > bx2)
-			{
-				swapvalues (block, endblock);
-			}
-			do
-			{
-				block->Push (line);
-				block += 1;
-			} while (block <= endblock);
-		}
-		else if (bx == bx2)	// Vertical line
-		{
-			if (by > by2)
-			{
-				swapvalues (block, endblock);
-			}
-			do
-			{
-				block->Push (line);
-				block += bmapwidth;
-			} while (block <= endblock);
-		}
-		else				// Diagonal line
-		{
-			int xchange = (dx < 0) ? -1 : 1;
-			int ychange = (dy < 0) ? -1 : 1;
-			int ymove = ychange * bmapwidth;
-			int adx = abs (dx);
-			int ady = abs (dy);
-
-			if (adx == ady)		// 45 degrees
-			{
-				int xb = (x1 - minx) & (BLOCKSIZE-1);
-				int yb = (y1 - miny) & (BLOCKSIZE-1);
-				if (dx < 0)
-				{
-					xb = BLOCKSIZE-xb;
-				}
-				if (dy < 0)
-				{
-					yb = BLOCKSIZE-yb;
-				}
-				if (xb < yb)
-					adx--;
-			}
-			if (adx >= ady)		// X-major
-			{
-				int yadd = dy < 0 ? -1 : BLOCKSIZE;
-				do
-				{
-					int stop = (Scale ((by << BLOCKBITS) + yadd - (y1 - miny), dx, dy) + (x1 - minx)) >> BLOCKBITS;
-					while (bx != stop)
-					{
-						block->Push (line);
-						block += xchange;
-						bx += xchange;
-					}
-					block->Push (line);
-					block += ymove;
-					by += ychange;
-				} while (by != by2);
-				while (block != endblock)
-				{
-					block->Push (line);
-					block += xchange;
-				}
-				block->Push (line);
-			}
-			else					// Y-major
-			{
-				int xadd = dx < 0 ? -1 : BLOCKSIZE;
-				do
-				{
-					int stop = (Scale ((bx << BLOCKBITS) + xadd - (x1 - minx), dy, dx) + (y1 - miny)) >> BLOCKBITS;
-					while (by != stop)
-					{
-						block->Push (line);
-						block += ymove;
-						by += ychange;
-					}
-					block->Push (line);
-					block += xchange;
-					bx += xchange;
-				} while (bx != bx2);
-				while (block != endblock)
-				{
-					block->Push (line);
-					block += ymove;
-				}
-				block->Push (line);
-			}
+			memcpy (&BlockLists[pos], &bands[i].Lines[0], bands[i].Lines.Size() * sizeof(int));
 		}
 	}
+	adder = BlockLists.Size();
+	BlockStarts.Push (adder);
 
 	BlockMap.Reserve (bmapwidth * bmapheight);
-	CreatePackedBlockmap (BlockMap, BlockLists, bmapwidth, bmapheight);
-	delete[] BlockLists;
+	CreatePackedBlockmap (BlockMap, BlockStarts, BlockLists, bmapwidth, bmapheight);
 
 	blockmaplump = new int[BlockMap.Size()];
-	for (unsigned int ii = 0; ii < BlockMap.Size(); ++ii)
-	{
-		blockmaplump[ii] = BlockMap[ii];
-	}
+	memcpy (blockmaplump, &BlockMap[0], BlockMap.Size() * sizeof(int));
+	return BlockMap.Size();
 }
 
 
@@ -3012,6 +3334,38 @@ static bool P_VerifyBlockMap(int count)
 	return true;
 }
 
+//
+// P_GenerateBlockMap
+//
+// Builds a blockmap from the lines, or takes it from the node cache if
+// it has been built for this map before.
+//
+static void P_GenerateBlockMap (MapData *map)
+{
+	int count;
+
+	blockmaplump = P_LoadCachedBlockMap (map, &count);
+	if (blockmaplump != NULL)
+	{
+		if (P_VerifyBlockMap (count))
+		{
+			DPrintf (DMSG_SPAMMY, "Using cached BLOCKMAP\n");
+			return;
+		}
+		delete[] blockmaplump;
+		blockmaplump = NULL;
+	}
+
+	DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
+	unsigned int startTime = I_FPSTime ();
+	count = P_CreateBlockMap ();
+	unsigned int endTime = I_FPSTime ();
+	if (count > 0)
+	{
+		P_CacheBlockMap (map, blockmaplump, count, endTime - startTime);
+	}
+}
+
 //
 // P_LoadBlockMap
 //
@@ -3030,8 +3384,7 @@ void P_LoadBlockMap (MapData * map)
 		Args->CheckParm("-blockmap")
 		)
 	{
-		DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-		P_CreateBlockMap ();
+		P_GenerateBlockMap (map);
 	}
 	else
 	{
@@ -3062,8 +3415,8 @@ void P_LoadBlockMap (MapData * map)
 
 		if (!P_VerifyBlockMap(count))
 		{
-			DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-			P_CreateBlockMap();
+			delete[] blockmaplump;
+			P_GenerateBlockMap(map);
 		}
 
 	}
@@ -3158,7 +3511,7 @@ static void P_GroupLines (bool buildmap)
 
 	// build line tables for each sector
 	times[3].Clock();
-	linebuffer = new line_t *[total];
+	linebuffer = P_AllocLevelArray<line_t *>(total);
 	line_t **lineb_p = linebuffer;
 	linesDoneInEachSector = new int[numsectors];
 	memset (linesDoneInEachSector, 0, sizeof(int)*numsectors);
@@ -3277,7 +3630,7 @@ void P_LoadReject (MapData * map, bool junk)
 	{
 		// Check if the reject has some actual content. If not, free it.
 		rejectsize = MIN (rejectsize, neededsize);
-		rejectmatrix = new BYTE[rejectsize];
+		rejectmatrix = P_AllocLevelArray<BYTE>(rejectsize);
 
 		map->Seek(ML_REJECT);
 		map->file->Read (rejectmatrix, rejectsize);
@@ -3305,7 +3658,7 @@ void P_LoadReject (MapData * map, bool junk)
 		}
 
 		// Reject has no data, so pretend it isn't there.
-		delete[] rejectmatrix;
+		// (The memory goes away with the rest of the level.)
 		rejectmatrix = NULL;
 	}
 }
@@ -3430,10 +3783,62 @@ static void P_PrecacheLevel()
 	delete[] hitlist;
 }
 
+//==========================================================================
+//
+// The level arena
+//
+// Sectors, lines, sides, the sector line lists and the reject table all
+// live for exactly as long as the level does, so instead of allocating
+// each of them separately they are packed into large blocks that are
+// thrown away together when the level is freed.
+//
+//==========================================================================
+
+struct FLevelArrayDestructor
+{
+	void (*Destroy)(void *, size_t);
+	void *Array;
+	size_t Count;
+};
+
+static FMemArena LevelArena(256*1024);
+static TArray<FLevelArrayDestructor> LevelArenaDestructors;
+static size_t LevelArenaUsed;
+
+void *P_AllocLevelData(size_t size, void (*destroy)(void *, size_t), size_t count)
+{
+	void *mem = LevelArena.Alloc(size);
+	LevelArenaUsed += size;
+	if (destroy != nullptr)
+	{
+		FLevelArrayDestructor dtor = { destroy, mem, count };
+		LevelArenaDestructors.Push(dtor);
+	}
+	return mem;
+}
+
+static void P_FreeLevelArena()
+{
+	// Destroy in reverse order of construction.
+	for (unsigned i = LevelArenaDestructors.Size(); i-- > 0; )
+	{
+		FLevelArrayDestructor &dtor = LevelArenaDestructors[i];
+		dtor.Destroy(dtor.Array, dtor.Count);
+	}
+	LevelArenaDestructors.Clear();
+	LevelArena.FreeAllBlocks();
+	LevelArenaUsed = 0;
+}
+
 extern polyblock_t **PolyBlockMap;
 
 void P_FreeLevelData ()
 {
+	cycle_t unloadtime;
+	size_t arenaused = LevelArenaUsed;
+
+	unloadtime.Reset();
+	unloadtime.Clock();
 	interpolator.ClearInterpolations();	// [RH] Nothing to interpolate on a fresh level.
 	Renderer->CleanLevelData();
 	FPolyObj::ClearAllSubsectorLinks(); // can't be done as part of the polyobj deletion process.
@@ -3463,12 +3868,7 @@ void P_FreeLevelData ()
 		delete[] glsegextras;
 		glsegextras = NULL;
 	}
-	if (sectors != NULL)
-	{
-		delete[] sectors[0].e;
-		delete[] sectors;
-		sectors = NULL;
-	}
+	sectors = NULL;
 	numsectors = 0;
 	if (gamenodes != NULL && gamenodes != nodes)
 	{
@@ -3497,17 +3897,9 @@ void P_FreeLevelData ()
 	numsubsectors = numgamesubsectors = 0;
 	nodes = gamenodes = NULL;
 	numnodes = numgamenodes = 0;
-	if (lines != NULL)
-	{
-		delete[] lines;
-		lines = NULL;
-	}
+	lines = NULL;
 	numlines = 0;
-	if (sides != NULL)
-	{
-		delete[] sides;
-		sides = NULL;
-	}
+	sides = NULL;
 	numsides = 0;
 
 	if (blockmaplump != NULL)
@@ -3535,16 +3927,8 @@ void P_FreeLevelData ()
 		delete[] PolyBlockMap;
 		PolyBlockMap = NULL;
 	}
-	if (rejectmatrix != NULL)
-	{
-		delete[] rejectmatrix;
-		rejectmatrix = NULL;
-	}
-	if (linebuffer != NULL)
-	{
-		delete[] linebuffer;
-		linebuffer = NULL;
-	}
+	rejectmatrix = NULL;
+	linebuffer = NULL;
 	if (polyobjs != NULL)
 	{
 		delete[] polyobjs;
@@ -3555,6 +3939,13 @@ void P_FreeLevelData ()
 	P_FreeStrifeConversations ();
 	level.Scrolls.Clear();
 	P_ClearUDMFKeys();
+	P_FreeLevelArena();
+
+	unloadtime.Unclock();
+	if (showloadtimes && arenaused > 0)
+	{
+		Printf ("Level data freed in %.4f ms (%u KB in level arena)\n", unloadtime.TimeMS(), unsigned(arenaused / 1024));
+	}
 }
 
 extern msecnode_t *headsecnode;
@@ -3595,6 +3986,7 @@ void P_FreeExtraLevelData()
 void P_SetupLevel (const char *lumpname, int position)
 {
 	cycle_t times[20];
+	cycle_t totaltime;
 	FMapThing *buildthings;
 	int numbuildthings;
 	int i;
@@ -3609,6 +4001,8 @@ void P_SetupLevel (const char *lumpname, int position)
 	{
 		times[i].Reset();
 	}
+	totaltime.Reset();
+	totaltime.Clock();
 
 	level.maptype = MAPTYPE_UNKNOWN;
 	wminfo.partime = 180;
@@ -4162,8 +4556,10 @@ void P_SetupLevel (const char *lumpname, int position)
 	}
 
 	P_ResetSightCounters (true);
+	P_ClearMapPrefetch();
 	//Printf ("free memory: 0x%x\n", Z_FreeMemory());
 
+	totaltime.Unclock();
 	if (showloadtimes)
 	{
 		Printf ("---Total load times---\n");
@@ -4192,6 +4588,7 @@ void P_SetupLevel (const char *lumpname, int position)
 			};
 			Printf ("Time%3d:%9.4f ms (%s)\n", i, times[i].TimeMS(), timenames[i]);
 		}
+		Printf ("Total:  %9.4f ms (%u KB in level arena)\n", totaltime.TimeMS(), unsigned(LevelArenaUsed / 1024));
 	}
 	MapThingsConverted.Clear();
 	MapThingsUserDataIndex.Clear();
@@ -4228,6 +4625,7 @@ void P_Init ()
 
 static void P_Shutdown ()
 {
+	P_ClearMapPrefetch ();
 	R_DeinitSpriteData ();
 	P_DeinitKeyMessages ();
 	P_FreeLevelData ();
@@ -23,6 +23,8 @@
 #ifndef __P_SETUP__
 #define __P_SETUP__
 
+#include <new>
+#include <type_traits>
 #include "resourcefiles/resourcefile.h"
 #include "doomdata.h"
 
@@ -95,6 +97,9 @@ struct MapData
 };
 
 MapData * P_OpenMapData(const char * mapname, bool justcheck);
+FileReader *P_OpenMapLump(int lump);
+void P_PrefetchMapLumps(const char *mapname);
+void P_ClearMapPrefetch();
 bool P_CheckMapData(const char * mapname);
 
 
@@ -108,6 +113,37 @@ void P_SetupLevel (const char *mapname, int position);
 void P_FreeLevelData();
 void P_FreeExtraLevelData();
 
+//==========================================================================
+//
+// Level-lifetime storage for the static map geometry. Everything in here
+// is released at once by P_FreeLevelData, so it must never be deleted
+// individually. Types that need a destructor get it called first.
+//
+//==========================================================================
+
+void *P_AllocLevelData(size_t size, void (*destroy)(void *, size_t) = nullptr, size_t count = 0);
+
+template<class T> void P_DestroyLevelArray(void *mem, size_t count)
+{
+	T *array = (T *)mem;
+	for (size_t i = 0; i < count; ++i)
+	{
+		array[i].~T();
+	}
+}
+
+template<class T> T *P_AllocLevelArray(size_t count)
+{
+	void *mem = P_AllocLevelData(count * sizeof(T),
+		std::is_trivially_destructible<T>::value ? nullptr : P_DestroyLevelArray<T>, count);
+	T *array = (T *)mem;
+	for (size_t i = 0; i < count; ++i)
+	{
+		new(&array[i]) T;
+	}
+	return array;
+}
+
 // Called by startup code.
 void P_Init (void);
 
@@ -122,6 +158,8 @@ int GetUDMFInt(int type, int index, const char *key);
 double GetUDMFFloat(int type, int index, const char *key);
 
 bool P_LoadGLNodes(MapData * map);
+int *P_LoadCachedBlockMap(MapData *map, int *count);
+void P_CacheBlockMap(MapData *map, const int *blockmap, int count, int buildtime);
 bool P_CheckNodes(MapData * map, bool rebuilt, int buildtime);
 bool P_CheckForGLNodes();
 void P_SetRenderSector();
@@ -908,7 +908,12 @@ done:
 	return res;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CheckSight)
+static bool Actor_CheckSight(AActor *self, AActor *target, int flags)
+{
+	return P_CheckSight(self, PARAM_NULLCHECK(target, target), flags);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, CheckSight, Actor_CheckSight)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT_NOT_NULL(target, AActor);
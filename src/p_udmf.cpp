@@ -48,6 +48,7 @@
 #include "w_wad.h"
 #include "p_tags.h"
 #include "p_terrain.h"
+#include "v_text.h"
 
 //===========================================================================
 //
@@ -139,6 +140,395 @@ extern TArray<int>		linemap;
 //
 //===========================================================================
 
+//===========================================================================
+//
+// FUDMFScanner
+//
+//===========================================================================
+
+FUDMFScanner::FUDMFScanner()
+{
+	String = NULL;
+	StringLen = 0;
+	TokenType = 0;
+	Number = 0;
+	Float = 0;
+	ScriptPos = ScriptEnd = TokenStart = TokenEnd = LinePos = NULL;
+	TokenHash = 0;
+	AlreadyGot = false;
+	Line = 1;
+	SetString("", 0);
+}
+
+//===========================================================================
+//
+// Returns a buffer for the caller to read the lump into. The scanner
+// works on it in place, so it must stay untouched while parsing.
+//
+//===========================================================================
+
+char *FUDMFScanner::Open(const char *name, int length)
+{
+	ScriptName = name;
+	Buffer.Resize(length + 1);
+	Buffer[length] = 0;		// lets strtol and strtod stop at the end
+	ScriptPos = LinePos = &Buffer[0];
+	ScriptEnd = ScriptPos + length;
+	TokenStart = TokenEnd = ScriptPos;
+	TokenType = 0;
+	AlreadyGot = false;
+	Line = 1;
+	for (auto &entry : KeyCache)
+	{
+		entry.Hash = 0;
+		entry.Len = 0;
+		entry.Name = NAME_None;
+	}
+	return &Buffer[0];
+}
+
+void FUDMFScanner::SetString(const char *text, int len)
+{
+	StringBuffer.Resize(len + 1);
+	memcpy(&StringBuffer[0], text, len);
+	StringBuffer[len] = 0;
+	String = &StringBuffer[0];
+	StringLen = len;
+}
+
+//===========================================================================
+//
+// FUDMFScanner :: GetToken
+//
+//===========================================================================
+
+bool FUDMFScanner::GetToken()
+{
+	if (AlreadyGot)
+	{
+		AlreadyGot = false;
+		return true;
+	}
+
+	const char *p = ScriptPos;
+	for (;;)
+	{
+		while (p < ScriptEnd && (BYTE)*p <= ' ') p++;
+		if (p + 1 < ScriptEnd && p[0] == '/' && p[1] == '/')
+		{
+			while (p < ScriptEnd && *p != '\n') p++;
+		}
+		else if (p + 1 < ScriptEnd && p[0] == '/' && p[1] == '*')
+		{
+			for (p += 2; p < ScriptEnd && !(p[0] == '*' && p + 1 < ScriptEnd && p[1] == '/'); p++) {}
+			p = MIN(p + 2, ScriptEnd);
+		}
+		else break;
+	}
+	if (p >= ScriptEnd)
+	{
+		ScriptPos = TokenStart = TokenEnd = ScriptEnd;
+		TokenType = 0;
+		return false;
+	}
+
+	TokenStart = p;
+	char c = *p;
+	if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+	{
+		// Hash the name while scanning it so that GetKeyName needn't look at it again.
+		unsigned int hash = 0;
+		while (p < ScriptEnd && (isalnum((BYTE)*p) || *p == '_'))
+		{
+			hash = hash * 31 + ((BYTE)*p | 0x20);
+			p++;
+		}
+		TokenHash = hash;
+		TokenEnd = p;
+		SetString(TokenStart, int(p - TokenStart));
+		if (StringLen == 4 && !stricmp(String, "true")) TokenType = TK_True;
+		else if (StringLen == 5 && !stricmp(String, "false")) TokenType = TK_False;
+		else TokenType = TK_Identifier;
+	}
+	else if ((c >= '0' && c <= '9') || (c == '.' && p + 1 < ScriptEnd && p[1] >= '0' && p[1] <= '9'))
+	{
+		ScanNumber();
+	}
+	else if (c == '"')
+	{
+		ScanString();
+	}
+	else
+	{
+		TokenEnd = p + 1;
+		TokenType = (BYTE)c;
+		SetString(p, 1);
+	}
+	ScriptPos = TokenEnd;
+	return true;
+}
+
+//===========================================================================
+//
+// Numbers are converted straight from the lump data. The common case of
+// a short decimal integer is done by hand, anything else is left to the
+// C library.
+//
+//===========================================================================
+
+void FUDMFScanner::ScanNumber()
+{
+	const char *p = TokenStart;
+	bool isfloat = false;
+
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+	{
+		for (p += 2; isxdigit((BYTE)*p); p++) {}
+	}
+	else
+	{
+		while (*p >= '0' && *p <= '9') p++;
+		if (*p == '.')
+		{
+			isfloat = true;
+			for (p++; *p >= '0' && *p <= '9'; p++) {}
+		}
+		if (*p == 'e' || *p == 'E')
+		{
+			const char *e = p + 1;
+			if (*e == '+' || *e == '-') e++;
+			if (*e >= '0' && *e <= '9')
+			{
+				isfloat = true;
+				for (p = e; *p >= '0' && *p <= '9'; p++) {}
+			}
+		}
+	}
+
+	if (isfloat)
+	{
+		Float = strtod(TokenStart, NULL);
+		TokenType = TK_FloatConst;
+		if (*p == 'f' || *p == 'F' || *p == 'l' || *p == 'L') p++;
+	}
+	else
+	{
+		bool isunsigned = false;
+		const char *digitsend = p;
+		for (int i = 0; i < 2 && (*p == 'u' || *p == 'U' || *p == 'l' || *p == 'L'); i++, p++)
+		{
+			if (*p == 'u' || *p == 'U') isunsigned = true;
+		}
+		if (isunsigned)
+		{
+			TokenType = TK_UIntConst;
+			Number = strtoul(TokenStart, NULL, 0);
+			Float = (unsigned)Number;
+		}
+		else
+		{
+			TokenType = TK_IntConst;
+			if (TokenStart[0] != '0' && digitsend - TokenStart <= 9)
+			{
+				int num = 0;
+				for (const char *d = TokenStart; d < digitsend; d++)
+				{
+					num = num * 10 + (*d - '0');
+				}
+				Number = num;
+			}
+			else
+			{
+				Number = strtol(TokenStart, NULL, 0);
+			}
+			Float = Number;
+		}
+	}
+	TokenEnd = MIN(p, ScriptEnd);
+	SetString(TokenStart, int(TokenEnd - TokenStart));
+}
+
+//===========================================================================
+//
+// String constants get their escape sequences processed like FScanner's.
+//
+//===========================================================================
+
+void FUDMFScanner::ScanString()
+{
+	const char *p = TokenStart + 1;
+	while (p < ScriptEnd && *p != '"')
+	{
+		if (*p == '\\' && p + 1 < ScriptEnd && p[1] == '"') p++;
+		p++;
+	}
+	if (p >= ScriptEnd)
+	{
+		ScriptError("Unterminated string constant.");
+	}
+	SetString(TokenStart + 1, int(p - TokenStart - 1));
+	StringLen = strbin(String);
+	TokenType = TK_StringConst;
+	TokenEnd = p + 1;
+}
+
+//===========================================================================
+//
+// FUDMFScanner :: token checks
+//
+//===========================================================================
+
+void FUDMFScanner::MustGetAnyToken()
+{
+	if (!GetToken())
+	{
+		ScriptError("Missing token (unexpected end of file).");
+	}
+}
+
+void FUDMFScanner::MustGetToken(int token)
+{
+	MustGetAnyToken();
+	if (TokenType != token)
+	{
+		FString tok1 = FScanner::TokenName(token);
+		FString tok2 = FScanner::TokenName(TokenType, String);
+		ScriptError("Expected %s but got %s instead.", tok1.GetChars(), tok2.GetChars());
+	}
+}
+
+bool FUDMFScanner::CheckToken(int token)
+{
+	if (GetToken())
+	{
+		if (TokenType == token)
+		{
+			return true;
+		}
+		UnGet();
+	}
+	return false;
+}
+
+bool FUDMFScanner::GetString()
+{
+	return GetToken();
+}
+
+void FUDMFScanner::MustGetString()
+{
+	if (!GetString())
+	{
+		ScriptError("Missing string (unexpected end of file).");
+	}
+}
+
+void FUDMFScanner::MustGetStringName(const char *name)
+{
+	MustGetString();
+	if (!Compare(name))
+	{
+		ScriptError("Expected '%s', got '%s'.", name, String);
+	}
+}
+
+bool FUDMFScanner::CheckString(const char *name)
+{
+	if (GetString())
+	{
+		if (Compare(name))
+		{
+			return true;
+		}
+		UnGet();
+	}
+	return false;
+}
+
+bool FUDMFScanner::Compare(const char *text) const
+{
+	return stricmp(text, String) == 0;
+}
+
+void FUDMFScanner::UnGet()
+{
+	AlreadyGot = true;
+}
+
+//===========================================================================
+//
+// FUDMFScanner :: GetKeyName
+//
+// Converts the current identifier to a name. A map uses the same few
+// dozen keys over and over, so every distinct key only goes through the
+// global name table once; after that it is found by its hash alone.
+//
+//===========================================================================
+
+FName FUDMFScanner::GetKeyName()
+{
+	if (TokenType != TK_Identifier && TokenType != TK_True && TokenType != TK_False)
+	{
+		return FName(String);
+	}
+
+	KeyCacheEntry &entry = KeyCache[TokenHash % KEYCACHE_SIZE];
+	if (entry.Hash == TokenHash && entry.Len == StringLen && !stricmp(entry.Name.GetChars(), String))
+	{
+		return entry.Name;
+	}
+	entry.Hash = TokenHash;
+	entry.Len = StringLen;
+	entry.Name = String;
+	return entry.Name;
+}
+
+//===========================================================================
+//
+// FUDMFScanner :: messages
+//
+// Line numbers are only counted when they're needed.
+//
+//===========================================================================
+
+int FUDMFScanner::GetLine()
+{
+	if (TokenStart < LinePos)
+	{
+		LinePos = &Buffer[0];
+		Line = 1;
+	}
+	for (; LinePos < TokenStart; LinePos++)
+	{
+		if (*LinePos == '\n') Line++;
+	}
+	return Line;
+}
+
+void FUDMFScanner::ScriptError(const char *message, ...)
+{
+	FString composed;
+	va_list arglist;
+
+	va_start(arglist, message);
+	composed.VFormat(message, arglist);
+	va_end(arglist);
+
+	I_Error("Script error, \"%s\" line %d:\n%s\n", ScriptName.GetChars(), GetLine(), composed.GetChars());
+}
+
+void FUDMFScanner::ScriptMessage(const char *message, ...)
+{
+	FString composed;
+	va_list arglist;
+
+	va_start(arglist, message);
+	composed.VFormat(message, arglist);
+	va_end(arglist);
+
+	Printf(TEXTCOLOR_RED "Script error, \"%s\" line %d:\n" TEXTCOLOR_RED "%s\n", ScriptName.GetChars(), GetLine(), composed.GetChars());
+}
+
 //===========================================================================
 //
 // Skip a key or block
@@ -188,7 +578,7 @@ void UDMFParserBase::Skip()
 FName UDMFParserBase::ParseKey(bool checkblock, bool *isblock)
 {
 	sc.MustGetString();
-	FName key = sc.String;
+	FName key = sc.GetKeyName();
 	if (checkblock)
 	{
 		if (sc.CheckToken('{'))
@@ -1784,8 +2174,8 @@ public:
 		}
 		numlines = ParsedLines.Size();
 		numsides = sidecount;
-		lines = new line_t[numlines];
-		sides = new side_t[numsides];
+		lines = P_AllocLevelArray<line_t>(numlines);
+		sides = P_AllocLevelArray<side_t>(numsides);
 		int line, side;
 
 		for(line = 0, side = 0; line < numlines; line++)
@@ -1837,16 +2227,11 @@ public:
 
 	void ParseTextMap(MapData *map)
 	{
-		char *buffer = new char[map->Size(ML_TEXTMAP)];
-
 		isTranslated = true;
 		isExtended = false;
 		floordrop = false;
 
-		map->Read(ML_TEXTMAP, buffer);
-		sc.OpenMem(Wads.GetLumpFullName(map->lumpnum), buffer, map->Size(ML_TEXTMAP));
-		delete [] buffer;
-		sc.SetCMode(true);
+		map->Read(ML_TEXTMAP, sc.Open(Wads.GetLumpFullName(map->lumpnum), map->Size(ML_TEXTMAP)));
 		if (sc.CheckString("namespace"))
 		{
 			sc.MustGetStringName("=");
@@ -1989,9 +2374,9 @@ public:
 
 		// Create the real sectors
 		numsectors = ParsedSectors.Size();
-		sectors = new sector_t[numsectors];
+		sectors = P_AllocLevelArray<sector_t>(numsectors);
 		memcpy(sectors, &ParsedSectors[0], numsectors * sizeof(*sectors));
-		sectors[0].e = new extsector_t[numsectors];
+		sectors[0].e = P_AllocLevelArray<extsector_t>(numsectors);
 		for(int i = 0; i < numsectors; i++)
 		{
 			sectors[i].e = &sectors[0].e[i];
@@ -4,10 +4,81 @@
 #include "sc_man.h"
 #include "m_fixed.h"
 
+//===========================================================================
+//
+// FUDMFScanner
+//
+// A scanner for UDMF and USDF lumps. Those only ever contain identifiers,
+// numbers, strings and a handful of punctuation, so instead of going
+// through FScanner this tokenizes directly over the lump's data without
+// creating a string for every token. It offers the subset of FScanner's
+// interface the parsers need.
+//
+// String always holds the text of the current token.
+//
+//===========================================================================
+
+class FUDMFScanner
+{
+public:
+	FUDMFScanner();
+
+	char *Open(const char *name, int length);
+
+	bool GetToken();
+	void MustGetAnyToken();
+	void MustGetToken(int token);
+	bool CheckToken(int token);
+	bool GetString();
+	void MustGetString();
+	void MustGetStringName(const char *name);
+	bool CheckString(const char *name);
+	bool Compare(const char *text) const;
+	void UnGet();
+	FName GetKeyName();
+
+	void ScriptError(const char *message, ...);
+	void ScriptMessage(const char *message, ...);
+
+	char *String;
+	int StringLen;
+	int TokenType;
+	int Number;
+	double Float;
+
+protected:
+	enum { KEYCACHE_SIZE = 512 };
+
+	struct KeyCacheEntry
+	{
+		unsigned int Hash;
+		int Len;
+		FName Name;
+	};
+
+	void SetString(const char *text, int len);
+	void ScanNumber();
+	void ScanString();
+	int GetLine();
+
+	TArray<char> Buffer;
+	TArray<char> StringBuffer;
+	FString ScriptName;
+	const char *ScriptPos;
+	const char *ScriptEnd;
+	const char *TokenStart;
+	const char *TokenEnd;
+	unsigned int TokenHash;
+	bool AlreadyGot;
+	const char *LinePos;
+	int Line;
+	KeyCacheEntry KeyCache[KEYCACHE_SIZE];
+};
+
 class UDMFParserBase
 {
 protected:
-	FScanner sc;
+	FUDMFScanner sc;
 	FName namespc;
 	int namespace_bits;
 	FString parsedString;
@@ -450,11 +450,7 @@ class USDFParser : public UDMFParserBase
 public:
 	bool Parse(int lumpnum, FileReader *lump, int lumplen)
 	{
-		char *buffer = new char[lumplen];
-		lump->Read(buffer, lumplen);
-		sc.OpenMem(Wads.GetLumpFullName(lumpnum), buffer, lumplen);
-		delete [] buffer;
-		sc.SetCMode(true);
+		lump->Read(sc.Open(Wads.GetLumpFullName(lumpnum), lumplen), lumplen);
 		// Namespace must be the first field because everything else depends on it.
 		if (sc.CheckString("namespace"))
 		{
@@ -803,6 +803,7 @@ FPolyObj::FPolyObj()
 	tag = 0;
 	memset(bbox, 0, sizeof(bbox));
 	validcount = 0;
+	memset(&BlockIterStamps, 0, sizeof(BlockIterStamps));
 	crush = 0;
 	bHurtOnTouch = false;
 	seqType = 0;
@@ -80,6 +80,7 @@ struct FPolyObj
 	int			tag;			// reference tag assigned in HereticEd
 	int			bbox[4];		// bounds in blockmap coordinates
 	int			validcount;
+	FBlockIteratorStamps BlockIterStamps;	// for FBlockLinesIterator
 	int			crush; 			// should the polyobj attempt to crush mobjs?
 	bool		bHurtOnTouch;	// should the polyobj hurt anything it touches?
 	bool		bBlocked;
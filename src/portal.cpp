@@ -155,7 +155,7 @@ static void BuildBlockmap()
 //
 //===========================================================================
 
-void FLinePortalTraverse::AddLineIntercepts(int bx, int by)
+void FLinePortalTraverse::AddLineIntercepts(int bx, int by, FBlockLinesIterator &it)
 {
 	if (by < 0 || by >= bmapheight || bx < 0 || bx >= bmapwidth) return;
 
@@ -167,7 +167,7 @@ void FLinePortalTraverse::AddLineIntercepts(int bx, int by)
 		double frac;
 		divline_t dl;
 
-		if (ld->validcount == validcount) continue;	// already processed
+		if (it.Visited(ld)) continue;	// already processed
 
 		if (P_PointOnDivlineSide (ld->v1->fPos(), &trace) ==
 			P_PointOnDivlineSide (ld->v2->fPos(), &trace))
@@ -1085,9 +1085,9 @@ void P_CreateLinkedPortals()
 	}
 
 	// reject would just get in the way when checking sight through portals.
-	if (Displacements.size > 1 && rejectmatrix != NULL)
+	// (It lives in the level arena, so only the reference needs to go.)
+	if (Displacements.size > 1)
 	{
-		delete[] rejectmatrix;
 		rejectmatrix = NULL;
 	}
 	// finally we must flag all planes which are obstructed by the sector's own ceiling or floor.
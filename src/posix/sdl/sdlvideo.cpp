@@ -12,9 +12,13 @@
 #include "v_palette.h"
 #include "sdlvideo.h"
 #include "r_swrenderer.h"
+#include "r_thread.h"
 #include "version.h"
 
 #include <SDL.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef __APPLE__
 #include <OpenGL/OpenGL.h>
@@ -73,8 +77,28 @@ private:
 	bool NeedGammaUpdate;
 	bool NotPaletted;
 
+	// Pipelined presentation: the frame is copied to PresentBuffer and
+	// converted into the locked texture on ConvertThread, while the game
+	// goes on with the next frame. It is shown by the next Update.
+	BYTE *PresentBuffer;
+	bool FramePending;
+	void *ConvertDest;
+	int ConvertDestPitch;
+	bool ConvertPending;
+	bool ConvertQuit;
+	std::thread ConvertThread;
+	std::mutex ConvertMutex;
+	std::condition_variable ConvertStart;
+	std::condition_variable ConvertDone;
+
 	void UpdateColors ();
+	void UpdateGammaAndColors ();
 	void ResetSDLRenderer ();
+	void PipelinedUpdate ();
+	void DirectUpdate ();
+	void ConvertThreadProc ();
+	void WaitForConversion ();
+	void DropPendingFrame ();
 
 	SDLFB () {}
 };
@@ -108,6 +132,10 @@ CVAR (Int, vid_displaybits, 32, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
 CVAR (Bool, vid_forcesurface, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
+// Overlaps converting and showing a frame with the next one, at the cost
+// of showing it one frame later.
+CVAR (Bool, vid_pipelinepresent, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
 CUSTOM_CVAR (Float, rgamma, 1.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 {
 	if (screen != NULL)
@@ -200,6 +228,36 @@ static MiniModeInfo WinModes[] =
 
 static cycle_t BlitCycles;
 static cycle_t SDLFlipCycles;
+static cycle_t ConvertCycles;
+
+// Converts the rows of the screen assigned to a drawer thread
+class ConvertScreenCommand : public DrawerCommand
+{
+	BYTE *Src;
+	int SrcPitch;
+	BYTE *Dest;
+	int DestPitch;
+	int Width, Height;
+
+public:
+	ConvertScreenCommand(BYTE *src, int srcpitch, void *dest, int destpitch, int width, int height)
+		: Src(src), SrcPitch(srcpitch), Dest((BYTE *)dest), DestPitch(destpitch), Width(width), Height(height)
+	{
+	}
+
+	void Execute(DrawerThread *thread) override
+	{
+		int count = thread->count_for_thread(0, Height);
+		int y = thread->skipped_by_thread(0);
+		for (; count > 0; count--, y += thread->num_cores)
+		{
+			GPfx.Convert (Src + y*SrcPitch, SrcPitch, Dest + y*DestPitch, DestPitch,
+				Width, 1, FRACUNIT, FRACUNIT, 0, 0);
+		}
+	}
+
+	FString DebugInfo() override { return "ConvertScreenCommand"; }
+};
 
 // CODE --------------------------------------------------------------------
 
@@ -361,6 +419,10 @@ SDLFB::SDLFB (int width, int height, bool fullscreen, SDL_Window *oldwin)
 	UpdatePending = false;
 	NotPaletted = false;
 	FlashAmount = 0;
+	PresentBuffer = NULL;
+	FramePending = false;
+	ConvertPending = false;
+	ConvertQuit = false;
 
 	if (oldwin)
 	{
@@ -404,6 +466,21 @@ SDLFB::SDLFB (int width, int height, bool fullscreen, SDL_Window *oldwin)
 
 SDLFB::~SDLFB ()
 {
+	if (ConvertThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(ConvertMutex);
+			ConvertQuit = true;
+		}
+		ConvertStart.notify_one();
+		ConvertThread.join();
+	}
+	DropPendingFrame ();
+	if (PresentBuffer != NULL)
+	{
+		delete[] PresentBuffer;
+	}
+
 	if (Renderer)
 	{
 		if (Texture)
@@ -479,6 +556,30 @@ void SDLFB::Update ()
 	SDLFlipCycles.Reset();
 	BlitCycles.Clock();
 
+	if (UsingRenderer && NotPaletted && vid_pipelinepresent)
+	{
+		PipelinedUpdate ();
+	}
+	else
+	{
+		DropPendingFrame ();
+		DirectUpdate ();
+	}
+
+	BlitCycles.Unclock();
+}
+
+//==========================================================================
+//
+// SDLFB :: DirectUpdate
+//
+// Converts and shows the frame right away. The conversion is spread over
+// the drawer threads.
+//
+//==========================================================================
+
+void SDLFB::DirectUpdate ()
+{
 	void *pixels;
 	int pitch;
 	if (UsingRenderer)
@@ -497,9 +598,9 @@ void SDLFB::Update ()
 
 	if (NotPaletted)
 	{
-		GPfx.Convert (MemBuffer, Pitch,
-			pixels, pitch, Width, Height,
-			FRACUNIT, FRACUNIT, 0, 0);
+		DrawerCommandQueue::Begin();
+		DrawerCommandQueue::QueueCommand<ConvertScreenCommand>(MemBuffer, Pitch, pixels, pitch, Width, Height);
+		DrawerCommandQueue::End();
 	}
 	else
 	{
@@ -535,8 +636,132 @@ void SDLFB::Update ()
 		SDLFlipCycles.Unclock();
 	}
 
-	BlitCycles.Unclock();
+	UpdateGammaAndColors ();
+}
 
+//==========================================================================
+//
+// SDLFB :: PipelinedUpdate
+//
+// Shows the frame that was handed to the convert thread by the previous
+// update, then hands over this one. All SDL calls stay on this thread.
+//
+//==========================================================================
+
+void SDLFB::PipelinedUpdate ()
+{
+	WaitForConversion ();
+	if (FramePending)
+	{
+		FramePending = false;
+		SDL_UnlockTexture (Texture);
+
+		SDLFlipCycles.Clock();
+		SDL_RenderClear(Renderer);
+		SDL_RenderCopy(Renderer, Texture, NULL, NULL);
+		SDL_RenderPresent(Renderer);
+		SDLFlipCycles.Unclock();
+	}
+
+	// Nothing is being converted now, so the palette can be changed.
+	UpdateGammaAndColors ();
+
+	if (SDL_LockTexture (Texture, NULL, &ConvertDest, &ConvertDestPitch))
+		return;
+
+	if (PresentBuffer == NULL)
+	{
+		PresentBuffer = new BYTE[Width*Height];
+	}
+	if (Pitch == Width)
+	{
+		memcpy (PresentBuffer, MemBuffer, Width*Height);
+	}
+	else
+	{
+		for (int y = 0; y < Height; ++y)
+		{
+			memcpy (PresentBuffer+y*Width, MemBuffer+y*Pitch, Width);
+		}
+	}
+
+	if (!ConvertThread.joinable())
+	{
+		ConvertThread = std::thread([this] { ConvertThreadProc(); });
+	}
+	{
+		std::lock_guard<std::mutex> lock(ConvertMutex);
+		ConvertPending = true;
+	}
+	ConvertStart.notify_one();
+	FramePending = true;
+}
+
+//==========================================================================
+//
+// SDLFB :: ConvertThreadProc
+//
+//==========================================================================
+
+void SDLFB::ConvertThreadProc ()
+{
+	std::unique_lock<std::mutex> lock(ConvertMutex);
+
+	for (;;)
+	{
+		ConvertStart.wait(lock, [this] { return ConvertQuit || ConvertPending; });
+		if (ConvertQuit)
+		{
+			break;
+		}
+		lock.unlock();
+
+		ConvertCycles.Reset();
+		ConvertCycles.Clock();
+		GPfx.Convert (PresentBuffer, Width,
+			ConvertDest, ConvertDestPitch, Width, Height,
+			FRACUNIT, FRACUNIT, 0, 0);
+		ConvertCycles.Unclock();
+
+		lock.lock();
+		ConvertPending = false;
+		ConvertDone.notify_one();
+	}
+}
+
+//==========================================================================
+//
+// SDLFB :: WaitForConversion
+//
+//==========================================================================
+
+void SDLFB::WaitForConversion ()
+{
+	std::unique_lock<std::mutex> lock(ConvertMutex);
+	ConvertDone.wait(lock, [this] { return !ConvertPending; });
+}
+
+//==========================================================================
+//
+// SDLFB :: DropPendingFrame
+//
+// Unlocks the texture if a frame is waiting in it. Needed before the
+// texture is destroyed or updated in any other way.
+//
+//==========================================================================
+
+void SDLFB::DropPendingFrame ()
+{
+	WaitForConversion ();
+	if (FramePending)
+	{
+		FramePending = false;
+		SDL_UnlockTexture (Texture);
+	}
+}
+
+void SDLFB::UpdateGammaAndColors ()
+{
 	if (NeedGammaUpdate)
 	{
 		bool Windowed = false;
@@ -657,6 +882,8 @@ bool SDLFB::IsFullscreen ()
 
 void SDLFB::ResetSDLRenderer ()
 {
+	DropPendingFrame ();
+
 	if (Renderer)
 	{
 		if (Texture)
@@ -781,7 +1008,7 @@ void SDLFB::ScaleCoordsFromWindow(SWORD &x, SWORD &y)
 ADD_STAT (blit)
 {
 	FString out;
-	out.Format ("blit=%04.1f ms  flip=%04.1f ms",
-		BlitCycles.TimeMS(), SDLFlipCycles.TimeMS());
+	out.Format ("blit=%04.1f ms  flip=%04.1f ms  convert=%04.1f ms",
+		BlitCycles.TimeMS(), SDLFlipCycles.TimeMS(), ConvertCycles.TimeMS());
 	return out;
 }
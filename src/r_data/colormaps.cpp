@@ -53,6 +53,8 @@
 #include "templates.h"
 #include "r_utility.h"
 #include "r_renderer.h"
+#include "r_state.h"
+#include "p_3dfloors.h"
 
 static bool R_CheckForFixedLights(const BYTE *colormaps);
 
@@ -107,6 +109,21 @@ static FSpecialColormapParameters SpecialColormapParms[] =
 
 static void FreeSpecialLights();
 
+// Dynamic colormaps are hashed by their color, fade and desaturation.
+// The light tables are only built when something is about to draw with
+// them, and the least recently used ones are freed again once there are
+// more than MAX_BUILT_LIGHTS of them.
+enum
+{
+	COLORMAP_HASH_SIZE = 256,
+	MAX_BUILT_LIGHTS = 512,
+};
+
+static FDynamicColormap *ColormapHash[COLORMAP_HASH_SIZE];
+static unsigned ColormapFrame;
+static unsigned NumBuiltLights;
+static bool LightsPending;
+
 
 
 //==========================================================================
@@ -185,39 +202,165 @@ int AddSpecialColormap(float r1, float g1, float b1, float r2, float g2, float b
 //
 //==========================================================================
 
-FDynamicColormap *GetSpecialLights (PalEntry color, PalEntry fade, int desaturate)
+//==========================================================================
+//
+// GetSpecialLights
+//
+// With lazy set, the light tables are not built until the next frame is
+// rendered, and only if a sector still uses them by then. Play code that
+// changes sector colors uses this, so a script that fades a sector through
+// a lot of colors does not build tables for the ones nobody sees.
+//
+//==========================================================================
+
+FDynamicColormap *GetSpecialLights (PalEntry color, PalEntry fade, int desaturate, bool lazy)
 {
 	FDynamicColormap *colormap;
 
+	// NormalLight is not hashed because its colors can be changed in place.
+	if (color == NormalLight.Color && fade == NormalLight.Fade && desaturate == NormalLight.Desaturate)
+	{
+		return &NormalLight;
+	}
+
 	// If this colormap has already been created, just return it
-	for (colormap = &NormalLight; colormap != NULL; colormap = colormap->Next)
+	unsigned bucket = (color.d * 31 + fade.d * 17 + desaturate) % COLORMAP_HASH_SIZE;
+	for (colormap = ColormapHash[bucket]; colormap != NULL; colormap = colormap->HashNext)
 	{
 		if (color == colormap->Color &&
 			fade == colormap->Fade &&
 			desaturate == colormap->Desaturate)
 		{
-			return colormap;
+			break;
 		}
 	}
 
-	// Not found. Create it.
-	colormap = new FDynamicColormap;
-	colormap->Next = NormalLight.Next;
-	colormap->Color = color;
-	colormap->Fade = fade;
-	colormap->Desaturate = desaturate;
-	NormalLight.Next = colormap;
-
-	if (Renderer->UsesColormap())
+	if (colormap == NULL)
 	{
-		colormap->Maps = new BYTE[NUMCOLORMAPS*256];
-		colormap->BuildLights ();
+		// Not found. Create it.
+		colormap = new FDynamicColormap;
+		colormap->Next = NormalLight.Next;
+		colormap->Color = color;
+		colormap->Fade = fade;
+		colormap->Desaturate = desaturate;
+		colormap->Maps = NULL;
+		colormap->LastUsed = ColormapFrame;
+		NormalLight.Next = colormap;
+		colormap->HashNext = ColormapHash[bucket];
+		ColormapHash[bucket] = colormap;
 	}
-	else colormap->Maps = NULL;
 
+	if (!lazy)
+	{
+		colormap->Validate ();
+	}
+	else if (colormap->Maps == NULL)
+	{
+		LightsPending = true;
+	}
 	return colormap;
 }
 
+//==========================================================================
+//
+// FDynamicColormap :: Validate
+//
+// Makes sure the light tables exist before anything draws with them.
+//
+//==========================================================================
+
+void FDynamicColormap::Validate ()
+{
+	LastUsed = ColormapFrame;
+	if (Maps == NULL && Renderer->UsesColormap())
+	{
+		Maps = new BYTE[NUMCOLORMAPS*256];
+		BuildLights ();
+		NumBuiltLights++;
+	}
+}
+
+//==========================================================================
+//
+// Frees the tables of the colormaps that have gone unused the longest.
+// Anything that was used in this or the previous frame is kept.
+//
+//==========================================================================
+
+static int lastusedcmp (const void *a, const void *b)
+{
+	unsigned ua = (*(FDynamicColormap **)a)->LastUsed;
+	unsigned ub = (*(FDynamicColormap **)b)->LastUsed;
+	return ua < ub ? -1 : ua > ub ? 1 : 0;
+}
+
+static void FreeUnusedLights ()
+{
+	TArray<FDynamicColormap *> unused;
+
+	for (FDynamicColormap *colormap = NormalLight.Next; colormap != NULL; colormap = colormap->Next)
+	{
+		if (colormap->Maps != NULL && ColormapFrame - colormap->LastUsed > 1)
+		{
+			unused.Push(colormap);
+		}
+	}
+	if (unused.Size() > 0)
+	{
+		qsort (&unused[0], unused.Size(), sizeof(unused[0]), lastusedcmp);
+	}
+	// Free a few more than necessary so this does not happen every frame.
+	for (unsigned i = 0; i < unused.Size() && NumBuiltLights > MAX_BUILT_LIGHTS * 3 / 4; ++i)
+	{
+		delete[] unused[i]->Maps;
+		unused[i]->Maps = NULL;
+		NumBuiltLights--;
+	}
+}
+
+//==========================================================================
+//
+// R_UpdateDynamicColormaps
+//
+// Called by the software renderer before it draws a frame. Builds all
+// tables that sectors need and that are still missing, and frees unused
+// ones when there are too many.
+//
+//==========================================================================
+
+void R_UpdateDynamicColormaps ()
+{
+	if (!Renderer->UsesColormap())
+	{
+		return;
+	}
+
+	ColormapFrame++;
+	if (!LightsPending && NumBuiltLights <= MAX_BUILT_LIGHTS)
+	{
+		return;
+	}
+	for (int i = 0; i < numsectors; ++i)
+	{
+		if (sectors[i].ColorMap != NULL)
+		{
+			sectors[i].ColorMap->Validate ();
+		}
+		for (auto &light : sectors[i].e->XFloor.lightlist)
+		{
+			if (light.extra_colormap != NULL)
+			{
+				light.extra_colormap->Validate ();
+			}
+		}
+	}
+	LightsPending = false;
+	if (NumBuiltLights > MAX_BUILT_LIGHTS)
+	{
+		FreeUnusedLights ();
+	}
+}
+
 //==========================================================================
 //
 // Free all lights created with GetSpecialLights
@@ -235,6 +378,9 @@ static void FreeSpecialLights()
 		delete colormap;
 	}
 	NormalLight.Next = NULL;
+	memset (ColormapHash, 0, sizeof(ColormapHash));
+	NumBuiltLights = 0;
+	LightsPending = false;
 }
 
 //==========================================================================
@@ -292,23 +438,16 @@ void FDynamicColormap::BuildLights ()
 			Fade.r, Fade.g, Fade.b, l * (256 / NUMCOLORMAPS));
 
 		shade = Maps + 256*l;
-		if ((DWORD)Color == MAKERGB(255,255,255))
-		{ // White light, so we can just pick the colors directly
-			for (c = 0; c < 256; c++)
-			{
-				*shade++ = ColorMatcher.Pick (colors[c].r, colors[c].g, colors[c].b);
-			}
-		}
-		else
-		{ // Colored light, so do the (slightly) slower thing
+		if ((DWORD)Color != MAKERGB(255,255,255))
+		{ // Colored light, so tint the colors first
 			for (c = 0; c < 256; c++)
 			{
-				*shade++ = ColorMatcher.Pick (
-					(colors[c].r*lr)>>8,
-					(colors[c].g*lg)>>8,
-					(colors[c].b*lb)>>8);
+				colors[c].r = (colors[c].r*lr)>>8;
+				colors[c].g = (colors[c].g*lg)>>8;
+				colors[c].b = (colors[c].b*lb)>>8;
 			}
 		}
+		ColorMatcher.PickMany (shade, colors, 256);
 	}
 }
 
@@ -372,14 +511,15 @@ void FDynamicColormap::RebuildAllLights()
 	{
 		FDynamicColormap *cm;
 
+		// The rest are built when they are needed.
 		for (cm = &NormalLight; cm != NULL; cm = cm->Next)
 		{
-			if (cm->Maps == NULL)
+			if (cm->Maps != NULL)
 			{
-				cm->Maps = new BYTE[NUMCOLORMAPS*256];
 				cm->BuildLights ();
 			}
 		}
+		LightsPending = true;
 	}
 }
 
@@ -18,6 +18,7 @@ struct FDynamicColormap
 	void ChangeColor (PalEntry lightcolor, int desaturate);
 	void ChangeColorFade (PalEntry lightcolor, PalEntry fadecolor);
 	void BuildLights ();
+	void Validate ();
 	static void RebuildAllLights();
 
 	BYTE *Maps;
@@ -25,6 +26,8 @@ struct FDynamicColormap
 	PalEntry Fade;
 	int Desaturate;
 	FDynamicColormap *Next;
+	FDynamicColormap *HashNext;		// next in GetSpecialLights' hash chain
+	unsigned LastUsed;				// frame this was last validated in
 };
 
 // For hardware-accelerated weapon sprites in colored sectors
@@ -84,7 +87,8 @@ extern FDynamicColormap FullNormalLight;
 }
 extern bool NormalLightHasFixedLights;
 
-FDynamicColormap *GetSpecialLights (PalEntry lightcolor, PalEntry fadecolor, int desaturate);
+FDynamicColormap *GetSpecialLights (PalEntry lightcolor, PalEntry fadecolor, int desaturate, bool lazy = false);
+void R_UpdateDynamicColormaps ();
 
 
 #endif
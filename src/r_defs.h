@@ -1204,6 +1204,7 @@ struct line_t
 	double		bbox[4];	// bounding box, for the extent of the LineDef.
 	sector_t	*frontsector, *backsector;
 	int 		validcount;	// if == validcount, already checked
+	FBlockIteratorStamps BlockIterStamps;	// for FBlockLinesIterator
 	int			locknumber;	// [Dusk] lock number for special
 	unsigned	portalindex;
 
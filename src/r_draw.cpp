@@ -492,6 +492,7 @@ namespace swrenderer
 			col = width + (col % width);
 		}
 
+		TexMan.MarkUsed(tex);
 		return tex->GetColumn(col, nullptr);
 	}
 
@@ -765,6 +766,7 @@ namespace swrenderer
 	{
 		using namespace drawerargs;
 
+		TexMan.MarkUsed(tex);
 		ds_source = tex->GetPixels();
 	}
 
@@ -1173,6 +1175,11 @@ namespace swrenderer
 		DrawerCommandQueue::QueueCommand<DrawColoredSpanPalCommand>(y, x1, x2);
 	}
 
+	void R_FillParticleRect(int x1, int x2, int y1, int y2, uint32_t fg, const uint32_t *bg2rgb)
+	{
+		DrawerCommandQueue::QueueCommand<FillParticleRectPalCommand>(x1, x2, y1, y2, fg, bg2rgb);
+	}
+
 	namespace
 	{
 		const uint8_t *slab_colormap;
@@ -157,6 +157,7 @@ namespace swrenderer
 	void R_FillSpan();
 	void R_DrawTiltedSpan(int y, int x1, int x2, const FVector3 &plane_sz, const FVector3 &plane_su, const FVector3 &plane_sv, bool plane_shade, int planeshade, float planelightfloat, fixed_t pviewx, fixed_t pviewy);
 	void R_DrawColoredSpan(int y, int x1, int x2);
+	void R_FillParticleRect(int x1, int x2, int y1, int y2, uint32_t fg, const uint32_t *bg2rgb);
 	void R_SetupDrawSlab(uint8_t *colormap);
 	void R_DrawSlab(int dx, fixed_t v, int dy, fixed_t vi, const uint8_t *vptr, uint8_t *p);
 	void R_DrawFogBoundary(int x1, int x2, short *uclip, short *dclip);
@@ -2559,6 +2559,41 @@ namespace swrenderer
 
 	/////////////////////////////////////////////////////////////////////////
 
+	FillParticleRectPalCommand::FillParticleRectPalCommand(int x1, int x2, int y1, int y2, uint32_t fg, const uint32_t *bg2rgb)
+		: x1(x1), x2(x2), y1(y1), y2(y2), fg(fg), bg2rgb(bg2rgb)
+	{
+		using namespace drawerargs;
+		destorg = dc_destorg;
+		pitch = dc_pitch;
+	}
+
+	void FillParticleRectPalCommand::Execute(DrawerThread *thread)
+	{
+		int count = thread->count_for_thread(y1, y2 - y1 + 1);
+		if (count <= 0)
+			return;
+
+		int width = x2 - x1;
+		int step = pitch * thread->num_cores;
+		uint8_t *dest = thread->dest_for_thread(y1, pitch, ylookup[y1] + x1 + destorg);
+		uint32_t fg = this->fg;
+		const uint32_t *bg2rgb = this->bg2rgb;
+
+		// Row by row, so that each thread touches contiguous memory.
+		do
+		{
+			for (int x = 0; x < width; x++)
+			{
+				uint32_t bg = bg2rgb[dest[x]];
+				bg = (fg + bg) | 0x1f07c1f;
+				dest[x] = RGB32k.All[bg & (bg >> 15)];
+			}
+			dest += step;
+		} while (--count);
+	}
+
+	/////////////////////////////////////////////////////////////////////////
+
 	DrawSlabPalCommand::DrawSlabPalCommand(int dx, fixed_t v, int dy, fixed_t vi, const uint8_t *vptr, uint8_t *p, const uint8_t *colormap)
 		: _dx(dx), _v(v), _dy(dy), _vi(vi), _vvptr(vptr), _p(p), _colormap(colormap)
 	{
@@ -215,6 +215,22 @@ namespace swrenderer
 		uint8_t *destorg;
 	};
 
+	class FillParticleRectPalCommand : public DrawerCommand
+	{
+	public:
+		FillParticleRectPalCommand(int x1, int x2, int y1, int y2, uint32_t fg, const uint32_t *bg2rgb);
+		void Execute(DrawerThread *thread) override;
+		FString DebugInfo() override { return "FillParticleRectPalCommand"; }
+
+	private:
+		int x1, x2;
+		int y1, y2;
+		uint32_t fg;
+		const uint32_t *bg2rgb;
+		uint8_t *destorg;
+		int pitch;
+	};
+
 	class DrawSlabPalCommand : public PalSpanCommand
 	{
 	public:
@@ -78,6 +78,25 @@ CUSTOM_CVAR (Int, r_columnmethod, 1, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR(Int, r_portal_recursions, 4, CVAR_ARCHIVE)
 CVAR(Bool, r_highlight_portals, false, CVAR_ARCHIVE)
 
+// Dynamic resolution: renders the 3D view at between r_dynres_min and
+// r_dynres_max of the screen resolution, trying to stay within
+// r_dynres_target milliseconds.
+CVAR(Bool, r_dynres, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Float, r_dynres_target, 16.6f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 1.f) self = 1.f;
+}
+CUSTOM_CVAR(Float, r_dynres_min, 0.5f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0.25f) self = 0.25f;
+	else if (self > 1.f) self = 1.f;
+}
+CUSTOM_CVAR(Float, r_dynres_max, 1.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0.25f) self = 0.25f;
+	else if (self > 1.f) self = 1.f;
+}
+
 EXTERN_CVAR(Bool, r_fullbrightignoresectorcolor)
 
 extern cycle_t WallCycles, PlaneCycles, MaskedCycles, WallScanCycles;
@@ -113,6 +132,7 @@ void R_DeinitSprites();
 // PRIVATE FUNCTION PROTOTYPES ---------------------------------------------
 
 static void R_ShutdownRenderer();
+static void R_FreeDynResCanvas();
 
 // EXTERNAL DATA DECLARATIONS ----------------------------------------------
 
@@ -124,6 +144,11 @@ extern subsector_t *InSubsector;
 
 // PRIVATE DATA DECLARATIONS -----------------------------------------------
 
+static DSimpleCanvas *DynResCanvas;
+static double DynResScale = 1.;
+static cycle_t DynResCycles;
+static int DynResWidth, DynResHeight;
+
 static double CurrentVisibility = 8.f;
 static double MaxVisForWall;
 static double MaxVisForFloor;
@@ -150,6 +175,7 @@ double			WallTMapScale2;
 
 
 bool			bRenderingToCanvas;	// [RH] True if rendering to a special canvas
+bool			bRenderingScaled;	// True if the canvas is a scaled down screen
 double			globaluclip, globaldclip;
 double			CenterX, CenterY;
 double			YaspectMul;
@@ -424,6 +450,7 @@ static void R_ShutdownRenderer()
 {
 	R_DeinitSprites();
 	R_DeinitPlanes();
+	R_FreeDynResCanvas();
 	// Free openings
 	if (openings != NULL)
 	{
@@ -838,6 +865,7 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 	R_3D_ResetClip(); // reset clips (floor/ceiling)
 
 	R_SetupBuffer ();
+	R_UpdateDynamicColormaps ();
 	R_SetupFrame (actor);
 
 	// Clear buffers.
@@ -972,6 +1000,170 @@ void R_RenderViewToCanvas (AActor *actor, DCanvas *canvas,
 	viewactive = savedviewactive;
 }
 
+//==========================================================================
+//
+// R_FreeDynResCanvas
+//
+//==========================================================================
+
+static void R_FreeDynResCanvas()
+{
+	if (DynResCanvas != NULL)
+	{
+		DynResCanvas->Unlock ();
+		DynResCanvas->Destroy();
+		DynResCanvas->ObjectFlags |= OF_YesReallyDelete;
+		delete DynResCanvas;
+		DynResCanvas = NULL;
+	}
+}
+
+//==========================================================================
+//
+// R_StretchView
+//
+// Copies the view from the dynamic resolution canvas to the view window
+// of the screen, doubling up pixels as needed.
+//
+//==========================================================================
+
+static void R_StretchView (const BYTE *src, int srcpitch, int srcwidth, int srcheight,
+	BYTE *dest, int destpitch, int destwidth, int destheight)
+{
+	fixed_t xstep = (srcwidth << FRACBITS) / destwidth;
+	fixed_t ystep = (srcheight << FRACBITS) / destheight;
+	fixed_t yfrac = 0;
+	int lastsy = -1;
+
+	for (int y = 0; y < destheight; y++, yfrac += ystep, dest += destpitch)
+	{
+		int sy = yfrac >> FRACBITS;
+		if (sy == lastsy)
+		{
+			memcpy (dest, dest - destpitch, destwidth);
+			continue;
+		}
+		const BYTE *row = src + sy * srcpitch;
+		fixed_t xfrac = 0;
+		for (int x = 0; x < destwidth; x++, xfrac += xstep)
+		{
+			dest[x] = row[xfrac >> FRACBITS];
+		}
+		lastsy = sy;
+	}
+}
+
+//==========================================================================
+//
+// R_RenderScaledView
+//
+// Renders the view to a canvas that is scale times the size of the
+// screen, laid out the same way, and stretches it over the view window.
+// The HUD is drawn afterwards at the full resolution as usual.
+//
+//==========================================================================
+
+static void R_RenderScaledView (AActor *actor, double scale)
+{
+	int savedx = viewwindowx, savedy = viewwindowy;
+	int destwidth = viewwidth, destheight = viewheight;
+	int fullwidth = MAX(int(SCREENWIDTH * scale), 16);
+	int fullheight = MAX(int(SCREENHEIGHT * scale), 16);
+	int stheight = MAX(int(ST_Y * scale), 16);
+
+	if (DynResCanvas == NULL || DynResCanvas->GetWidth() != fullwidth || DynResCanvas->GetHeight() != fullheight)
+	{
+		R_FreeDynResCanvas ();
+		DynResCanvas = new DSimpleCanvas (fullwidth, fullheight);
+		DynResCanvas->ObjectFlags |= OF_Fixed;
+		DynResCanvas->Lock ();
+	}
+
+	R_BeginDrawerCommands();
+
+	RenderTarget = DynResCanvas;
+	bRenderingToCanvas = true;
+	bRenderingScaled = true;
+	R_SetWindow (setblocks, fullwidth, fullheight, stheight);
+	viewwindowx = (fullwidth - viewwidth) >> 1;
+	viewwindowy = (viewwidth == fullwidth) ? 0 : (stheight - viewheight) >> 1;
+	DynResWidth = viewwidth;
+	DynResHeight = viewheight;
+
+	R_RenderActorView (actor);
+
+	R_EndDrawerCommands();
+
+	R_StretchView (DynResCanvas->GetBuffer() + viewwindowy * DynResCanvas->GetPitch() + viewwindowx,
+		DynResCanvas->GetPitch(), viewwidth, viewheight,
+		screen->GetBuffer() + savedy * screen->GetPitch() + savedx,
+		screen->GetPitch(), destwidth, destheight);
+
+	RenderTarget = screen;
+	bRenderingToCanvas = false;
+	bRenderingScaled = false;
+	R_SetWindow (setblocks, SCREENWIDTH, SCREENHEIGHT, ST_Y);
+	viewwindowx = savedx;
+	viewwindowy = savedy;
+	R_SetupBuffer ();
+}
+
+//==========================================================================
+//
+// R_RenderMainView
+//
+// Renders the player's view to the screen. With r_dynres, the resolution
+// for the next frame is picked from how long this one took, assuming the
+// time is proportional to the number of pixels.
+//
+//==========================================================================
+
+void R_RenderMainView (AActor *actor)
+{
+	// Only use a few distinct sizes so that the canvas is not reallocated
+	// for every frame.
+	double scale = floor(DynResScale * 16 + 0.5) / 16;
+
+	DynResCycles.Reset();
+	DynResCycles.Clock();
+	if (r_dynres && scale < 1.)
+	{
+		R_RenderScaledView (actor, scale);
+	}
+	else
+	{
+		R_BeginDrawerCommands();
+		R_RenderActorView (actor);
+		R_EndDrawerCommands();
+		DynResWidth = viewwidth;
+		DynResHeight = viewheight;
+	}
+	DynResCycles.Unclock();
+
+	if (r_dynres)
+	{
+		double maxscale = r_dynres_max;
+		double minscale = MIN<double>(r_dynres_min, maxscale);
+		double ideal = scale * sqrt(r_dynres_target / MAX(DynResCycles.TimeMS(), 0.1));
+
+		// Only go part of the way to ignore spikes.
+		DynResScale = clamp(DynResScale + (ideal - DynResScale) * 0.25, minscale, maxscale);
+	}
+	else
+	{
+		DynResScale = 1.;
+		R_FreeDynResCanvas ();
+	}
+}
+
+ADD_STAT (dynres)
+{
+	FString out;
+	out.Format ("scale=%.2f  view=%dx%d  render=%04.1f ms  target=%04.1f ms",
+		r_dynres ? DynResScale : 1., DynResWidth, DynResHeight, DynResCycles.TimeMS(), (float)r_dynres_target);
+	return out;
+}
+
 //==========================================================================
 //
 // R_MultiresInit
@@ -42,6 +42,7 @@ namespace swrenderer
 // POV related.
 //
 extern bool				bRenderingToCanvas;
+extern bool				bRenderingScaled;
 extern fixed_t			viewingrangerecip;
 extern double			FocalLengthX, FocalLengthY;
 extern double			InvZtoScale;
@@ -133,6 +134,7 @@ void R_InitTextureMapping ();
 
 // Called by G_Drawer.
 void R_RenderActorView (AActor *actor, bool dontmaplines = false);
+void R_RenderMainView (AActor *actor);
 void R_SetupBuffer ();
 
 void R_RenderViewToCanvas (AActor *actor, DCanvas *canvas, int x, int y, int width, int height, bool dontmaplines = false);
@@ -58,6 +58,7 @@
 #include "r_3dfloors.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
+#include "memarena.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable:4244)
@@ -75,6 +76,7 @@ namespace swrenderer
 extern subsector_t *InSubsector;
 
 static void R_DrawSkyStriped (visplane_t *pl);
+static void R_MergePlanes (visplane_t *pl);
 
 planefunction_t 		floorfunc;
 planefunction_t 		ceilingfunc;
@@ -90,6 +92,14 @@ static visplane_t		*visplanes[MAXVISPLANES+1];	// killough
 static visplane_t		*freetail;					// killough
 static visplane_t		**freehead = &freetail;		// killough
 
+// Visplanes are never freed individually, only all at once, so they are
+// carved out of large blocks instead of being allocated one at a time.
+enum { VISPLANE_SIZE = sizeof(visplane_t) + 3 + sizeof(unsigned short)*(MAXWIDTH*2) };
+static FMemArena		VisplaneArena(VISPLANE_SIZE * 32);
+
+static int				PlanesReused;
+static int				SpansRecorded, SpansDrawn;
+
 visplane_t 				*floorplane;
 visplane_t 				*ceilingplane;
 
@@ -182,12 +192,9 @@ void R_DeinitPlanes ()
 			freehead = &(*freehead)->next;
 		}
 	}
-	for (visplane_t *pl = freetail; pl != NULL; )
-	{
-		visplane_t *next = pl->next;
-		free (pl);
-		pl = next;
-	}
+	freetail = NULL;
+	freehead = &freetail;
+	VisplaneArena.FreeAllBlocks();
 }
 
 //==========================================================================
@@ -324,6 +331,10 @@ void R_ClearPlanes (bool fullclear)
 			? (ConBottom - viewwindowy) : 0);
 
 		lastopening = 0;
+
+		PlanesReused = 0;
+		SpansRecorded = 0;
+		SpansDrawn = 0;
 	}
 }
 
@@ -342,8 +353,8 @@ static visplane_t *new_visplane (unsigned hash)
 
 	if (check == NULL)
 	{
-		check = (visplane_t *)M_Malloc (sizeof(*check) + 3 + sizeof(*check->top)*(MAXWIDTH*2));
-		memset(check, 0, sizeof(*check) + 3 + sizeof(*check->top)*(MAXWIDTH*2));
+		check = (visplane_t *)VisplaneArena.Alloc (VISPLANE_SIZE);
+		memset(check, 0, VISPLANE_SIZE);
 		check->bottom = check->top + MAXWIDTH+2;
 	}
 	else if (NULL == (freetail = freetail->next))
@@ -351,11 +362,41 @@ static visplane_t *new_visplane (unsigned hash)
 		freehead = &freetail;
 	}
 
+	check->MergeNext = NULL;
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
 	return check;
 }
 
+//==========================================================================
+//
+// R_PlanesMatch
+//
+// True if two visplanes would draw exactly the same way and only differ
+// in the columns they cover.
+//
+//==========================================================================
+
+static bool R_PlanesMatch (const visplane_t *a, const visplane_t *b)
+{
+	return a->height == b->height &&
+		a->picnum == b->picnum &&
+		a->lightlevel == b->lightlevel &&
+		a->xform == b->xform &&
+		a->colormap == b->colormap &&
+		a->sky == b->sky &&
+		a->portal == b->portal &&
+		a->extralight == b->extralight &&
+		a->visibility == b->visibility &&
+		a->viewpos == b->viewpos &&
+		a->viewangle == b->viewangle &&
+		a->Alpha == b->Alpha &&
+		a->Additive == b->Additive &&
+		a->CurrentPortalUniq == b->CurrentPortalUniq &&
+		a->MirrorFlags == b->MirrorFlags &&
+		a->CurrentSkybox == b->CurrentSkybox;
+}
+
 
 //==========================================================================
 //
@@ -555,6 +596,28 @@ visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
 		else
 		{
 			hash = visplane_hash (pl->picnum.GetIndex(), pl->lightlevel, pl->height);
+
+			// Before that, see if an earlier split of this plane still has
+			// these columns free. Open areas tend to split the same flat
+			// many times, and most of the pieces do not overlap each other.
+			for (visplane_t *check = visplanes[hash]; check != NULL; check = check->next)
+			{
+				if (check == pl || !R_PlanesMatch (check, pl))
+				{
+					continue;
+				}
+				intrl = MAX (start, check->left);
+				intrh = MIN (stop, check->right);
+				for (x = intrl; x < intrh && check->top[x] == 0x7fff; x++)
+					;
+				if (x >= intrh)
+				{
+					check->left = MIN (start, check->left);
+					check->right = MAX (stop, check->right);
+					PlanesReused++;
+					return check;
+				}
+			}
 		}
 		visplane_t *new_pl = new_visplane (hash);
 
@@ -954,21 +1017,151 @@ int R_DrawPlanes ()
 
 	for (i = 0; i < MAXVISPLANES; i++)
 	{
+		for (pl = visplanes[i]; pl; pl = pl->next)
+		{
+			pl->Merged = false;
+		}
 		for (pl = visplanes[i]; pl; pl = pl->next)
 		{
 			// kg3D - draw only correct planes
 			if(pl->CurrentPortalUniq != CurrentPortalUniq || pl->CurrentSkybox != CurrentSkybox)
 				continue;
 			// kg3D - draw only real planes now
-			if(pl->sky >= 0) {
+			if(pl->sky >= 0 && !pl->Merged) {
 				vpcount++;
+				R_MergePlanes (pl);
 				R_DrawSinglePlane (pl, OPAQUE, false, false);
+				for (visplane_t *next, *merged = pl; merged != NULL; merged = next)
+				{
+					next = merged->MergeNext;
+					merged->MergeNext = NULL;
+				}
 			}
 		}
 	}
 	return vpcount;
 }
 
+//==========================================================================
+//
+// R_MergePlanes
+//
+// Chains all later planes in pl's hash bucket that draw the same way
+// as pl to it, so that their spans can be drawn together.
+//
+//==========================================================================
+
+static void R_MergePlanes (visplane_t *pl)
+{
+	pl->MergeNext = NULL;
+	if (r_drawflat || tilt || pl->left >= pl->right || pl->picnum == skyflatnum || pl->height.isSlope())
+	{
+		return;
+	}
+	visplane_t **tail = &pl->MergeNext;
+	for (visplane_t *check = pl->next; check != NULL; check = check->next)
+	{
+		if (!check->Merged && check->left < check->right && R_PlanesMatch (check, pl))
+		{
+			check->Merged = true;
+			*tail = check;
+			tail = &check->MergeNext;
+		}
+	}
+	*tail = NULL;
+}
+
+//==========================================================================
+//
+// R_RecordSpan
+//
+// Used as a mapfunc to collect the spans of merged planes.
+//
+//==========================================================================
+
+struct FPlaneSpan
+{
+	short y, x1, x2;
+};
+
+static TArray<FPlaneSpan> PlaneSpans;
+
+static void R_RecordSpan (int y, int x1)
+{
+	FPlaneSpan span = { (short)y, (short)x1, spanend[y] };
+	PlaneSpans.Push(span);
+}
+
+static int spancmp (const void *a, const void *b)
+{
+	const FPlaneSpan *sa = (const FPlaneSpan *)a;
+	const FPlaneSpan *sb = (const FPlaneSpan *)b;
+	if (sa->y != sb->y) return sa->y - sb->y;
+	return sa->x1 - sb->x1;
+}
+
+//==========================================================================
+//
+// R_MapMergedPlanes
+//
+// Collects the spans of pl and everything merged into it, joins spans that
+// touch on the same row and draws the result. Texture coordinates and
+// lighting only depend on the screen position, so a joined span looks
+// exactly like the pieces it was made from.
+//
+//==========================================================================
+
+static void R_MapMergedPlanes (visplane_t *pl)
+{
+	// basexfrac/baseyfrac are set up for the rightmost column of pl.
+	const double rightxfrac = basexfrac, rightyfrac = baseyfrac;
+	const int right = pl->right - 1;
+
+	PlaneSpans.Clear();
+	for (visplane_t *p = pl; p != NULL; p = p->MergeNext)
+	{
+		basexfrac = rightxfrac;
+		baseyfrac = rightyfrac;
+		R_MapVisPlane (p, R_RecordSpan);
+	}
+	if (PlaneSpans.Size() == 0)
+	{
+		return;
+	}
+	qsort (&PlaneSpans[0], PlaneSpans.Size(), sizeof(FPlaneSpan), spancmp);
+	SpansRecorded += PlaneSpans.Size();
+
+	FPlaneSpan cur = PlaneSpans[0];
+	for (unsigned i = 1; i <= PlaneSpans.Size(); ++i)
+	{
+		if (i < PlaneSpans.Size())
+		{
+			const FPlaneSpan &span = PlaneSpans[i];
+			if (span.y == cur.y && span.x1 <= cur.x2 + 1)
+			{
+				cur.x2 = MAX (cur.x2, span.x2);
+				continue;
+			}
+		}
+		spanend[cur.y] = cur.x2;
+		basexfrac = rightxfrac - (right - cur.x1) * xstepscale;
+		baseyfrac = rightyfrac - (right - cur.x1) * ystepscale;
+		R_MapPlane (cur.y, cur.x1);
+		SpansDrawn++;
+		if (i < PlaneSpans.Size())
+		{
+			cur = PlaneSpans[i];
+		}
+	}
+}
+
+ADD_STAT(planes)
+{
+	FString out;
+	out.Format ("%d plane splits avoided, %d merged spans drawn as %d", PlanesReused, SpansRecorded, SpansDrawn);
+	return out;
+}
+
 // kg3D - draw all visplanes with "height"
 void R_DrawHeightPlanes(double height)
 {
@@ -1547,7 +1740,14 @@ void R_DrawNormalPlane (visplane_t *pl, double _xscale, double _yscale, fixed_t
 			}
 		}
 	}
-	R_MapVisPlane (pl, R_MapPlane);
+	if (pl->MergeNext != NULL)
+	{
+		R_MapMergedPlanes (pl);
+	}
+	else
+	{
+		R_MapVisPlane (pl, R_MapPlane);
+	}
 }
 
 //==========================================================================
@@ -1754,32 +1954,14 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 
 bool R_PlaneInitData ()
 {
-	int i;
-	visplane_t *pl;
-
 	// Free all visplanes and let them be re-allocated as needed.
-	pl = freetail;
-
-	while (pl)
-	{
-		visplane_t *next = pl->next;
-		M_Free (pl);
-		pl = next;
-	}
 	freetail = NULL;
 	freehead = &freetail;
-
-	for (i = 0; i < MAXVISPLANES; i++)
+	for (int i = 0; i <= MAXVISPLANES; i++)
 	{
-		pl = visplanes[i];
 		visplanes[i] = NULL;
-		while (pl)
-		{
-			visplane_t *next = pl->next;
-			M_Free (pl);
-			pl = next;
-		}
 	}
+	VisplaneArena.FreeAllBlocks();
 
 	return true;
 }
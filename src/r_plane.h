@@ -63,6 +63,9 @@ struct visplane_s
 	int CurrentPortalUniq; // mirror counter, counts all of them
 	int MirrorFlags; // this is not related to CurrentMirror
 
+	visplane_s *MergeNext;			// other planes drawn together with this one
+	bool Merged;
+
 	unsigned short *bottom;			// [RH] bottom and top arrays are dynamically
 	unsigned short pad;				//		allocated immediately after the
 	unsigned short top[];			//		visplane.
@@ -99,6 +99,7 @@ void FSoftwareRenderer::PrecacheTexture(FTexture *tex, int cache)
 		}
 		else
 		{
+			TexMan.RemoveResident(tex);
 			tex->Unload ();
 		}
 	}
@@ -161,11 +162,13 @@ void FSoftwareRenderer::Precache(BYTE *texhitlist, TMap<PClassActor*, bool> &act
 
 void FSoftwareRenderer::RenderView(player_t *player)
 {
-	R_BeginDrawerCommands();
-	R_RenderActorView (player->mo);
+	R_RenderMainView (player->mo);
 	// [RH] Let cameras draw onto textures that were visible this frame.
+	R_BeginDrawerCommands();
 	FCanvasTextureInfo::UpdateAll ();
 	R_EndDrawerCommands();
+	// The drawers are done with this frame's texture data, so it is safe to evict some.
+	TexMan.TrimResident();
 }
 
 //==========================================================================
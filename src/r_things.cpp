@@ -261,6 +261,7 @@ void R_DrawMaskedColumn (FTexture *tex, fixed_t col, bool useRt, bool unmasked)
 	const FTexture::Span *span;
 	const BYTE *column;
 
+	TexMan.MarkUsed(tex);
 	column = tex->GetColumn(col >> FRACBITS, &span);
 
 	FTexture::Span unmaskedSpan[2];
@@ -1365,14 +1366,16 @@ void R_DrawPSprite(DPSprite *pspr, AActor *owner, float bobx, float boby, double
 
 	vis->texturemid = (BASEYCENTER - sy) * tex->Scale.Y + tex->TopOffset;
 
-	if (camera->player && (RenderTarget != screen ||
+	// A scaled down screen is treated like the screen itself here.
+	bool ownview = RenderTarget != screen && !bRenderingScaled;
+	if (camera->player && (ownview ||
 		viewheight == RenderTarget->GetHeight() ||
 		(RenderTarget->GetWidth() > (BASEXCENTER * 2) && !st_scale)))
 	{	// Adjust PSprite for fullscreen views
 		AWeapon *weapon = dyn_cast<AWeapon>(pspr->GetCaller());
 		if (weapon != nullptr && weapon->YAdjust != 0)
 		{
-			if (RenderTarget != screen || viewheight == RenderTarget->GetHeight())
+			if (ownview || viewheight == RenderTarget->GetHeight())
 			{
 				vis->texturemid -= weapon->YAdjust;
 			}
@@ -2646,19 +2649,14 @@ static void R_DrawMaskedSegsBehindParticle (const vissprite_t *vis)
 void R_DrawParticle_C (vissprite_t *vis)
 {
 	DWORD *bg2rgb;
-	int spacing;
-	BYTE *dest;
 	DWORD fg;
 	BYTE color = vis->Style.colormap[vis->startfrac];
-	int yl = vis->y1;
-	int ycount = vis->y2 - yl + 1;
 	int x1 = vis->x1;
-	int countbase = vis->x2 - x1;
+	int x2 = vis->x2;
 
+	// The masked segs are queued before the particle, so they still end up behind it.
 	R_DrawMaskedSegsBehindParticle (vis);
 
-	DrawerCommandQueue::WaitForWorkers();
-
 	// vis->renderflags holds translucency level (0-255)
 	{
 		fixed_t fglevel, bglevel;
@@ -2671,43 +2669,29 @@ void R_DrawParticle_C (vissprite_t *vis)
 		fg = fg2rgb[color];
 	}
 
-	/*
-
-	spacing = RenderTarget->GetPitch() - countbase;
-	dest = ylookup[yl] + x1 + dc_destorg;
-
-	do
-	{
-		int count = countbase;
-		do
-		{
-			DWORD bg = bg2rgb[*dest];
-			bg = (fg+bg) | 0x1f07c1f;
-			*dest++ = RGB32k.All[bg & (bg>>15)];
-		} while (--count);
-		dest += spacing;
-	} while (--ycount);*/
-
-	// original was row-wise
-	// width = countbase
-	// height = ycount
-
-	spacing = RenderTarget->GetPitch();
-
-	for (int x = x1; x < (x1+countbase); x++)
+	// Queue one rectangle per run of columns that are not clipped by a portal.
+	// Most particles are not clipped at all and become a single drawer command.
+	int runstart = -1;
+	for (int x = x1; x < x2; x++)
 	{
 		dc_x = x;
 		if (R_ClipSpriteColumnWithPortals(vis))
-			continue;
-		dest = ylookup[yl] + x + dc_destorg;
-		for (int y = 0; y < ycount; y++)
 		{
-			DWORD bg = bg2rgb[*dest];
-			bg = (fg+bg) | 0x1f07c1f;
-			*dest = RGB32k.All[bg & (bg>>15)];
-			dest += spacing;
+			if (runstart >= 0)
+			{
+				R_FillParticleRect(runstart, x, vis->y1, vis->y2, fg, bg2rgb);
+				runstart = -1;
+			}
+		}
+		else if (runstart < 0)
+		{
+			runstart = x;
 		}
 	}
+	if (runstart >= 0)
+	{
+		R_FillParticleRect(runstart, x2, vis->y1, vis->y2, fg, bg2rgb);
+	}
 }
 
 extern double BaseYaspectMul;;
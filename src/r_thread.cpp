@@ -32,6 +32,7 @@
 #include "g_game.h"
 #include "g_level.h"
 #include "r_thread.h"
+#include "stats.h"
 
 CVAR(Bool, r_multithreaded, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
@@ -54,6 +55,7 @@ DrawerCommandQueue *DrawerCommandQueue::Instance()
 }
 
 DrawerCommandQueue::DrawerCommandQueue()
+	: memorypool(1024 * 1024)
 {
 }
 
@@ -68,12 +70,24 @@ void* DrawerCommandQueue::AllocMemory(size_t size)
 	size = (size + 15) / 16 * 16;
 
 	auto queue = Instance();
-	if (queue->memorypool_pos + size > memorypool_size)
-		return nullptr;
+	queue->memorypool_used += size;
+	char *data = (char *)queue->memorypool.Alloc(size + 15);
+	return (void *)(((size_t)data + 15) & ~(size_t)15);
+}
+
+FString DrawerCommandQueue::GetStats()
+{
+	auto queue = Instance();
+	FString out;
+	out.Format("Commands: %zu, peak %zu. Memory: %zuk, peak %zuk",
+		queue->batch_commands, queue->batch_peak_commands,
+		queue->batch_memory / 1024, queue->memorypool_peak / 1024);
+	return out;
+}
 
-	void *data = queue->memorypool + queue->memorypool_pos;
-	queue->memorypool_pos += size;
-	return data;
+ADD_STAT(drawerqueue)
+{
+	return DrawerCommandQueue::GetStats();
 }
 
 void DrawerCommandQueue::Begin()
@@ -173,8 +187,13 @@ void DrawerCommandQueue::Finish()
 
 	for (auto &command : queue->active_commands)
 		command->~DrawerCommand();
+	queue->batch_commands = queue->active_commands.size();
+	queue->batch_peak_commands = MAX(queue->batch_peak_commands, queue->batch_commands);
 	queue->active_commands.clear();
-	queue->memorypool_pos = 0;
+	queue->batch_memory = queue->memorypool_used;
+	queue->memorypool_peak = MAX(queue->memorypool_peak, queue->memorypool_used);
+	queue->memorypool_used = 0;
+	queue->memorypool.FreeAll();
 	queue->finished_threads = 0;
 }
 
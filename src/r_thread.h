@@ -23,6 +23,7 @@
 #pragma once
 
 #include "r_draw.h"
+#include "memarena.h"
 #include <vector>
 #include <memory>
 #include <thread>
@@ -141,7 +142,11 @@ protected:
 public:
 	DrawerCommand()
 	{
-		_dest_y = static_cast<int>((swrenderer::drawerargs::dc_dest - swrenderer::drawerargs::dc_destorg) / (swrenderer::drawerargs::dc_pitch));
+		// dc_pitch is not set up before the first 3D view has been rendered.
+		if (swrenderer::drawerargs::dc_pitch != 0)
+			_dest_y = static_cast<int>((swrenderer::drawerargs::dc_dest - swrenderer::drawerargs::dc_destorg) / (swrenderer::drawerargs::dc_pitch));
+		else
+			_dest_y = 0;
 	}
 	
 	virtual ~DrawerCommand() { }
@@ -155,9 +160,15 @@ void VectoredTryCatch(void *data, void(*tryBlock)(void *data), void(*catchBlock)
 // Manages queueing up commands and executing them on worker threads
 class DrawerCommandQueue
 {
-	enum { memorypool_size = 16 * 1024 * 1024 };
-	char memorypool[memorypool_size];
-	size_t memorypool_pos = 0;
+	// Command memory is taken from an arena that keeps its blocks between
+	// batches, so it grows to the largest batch seen and then stops
+	// allocating. It is never flushed early for lack of space.
+	FMemArena memorypool;
+	size_t memorypool_used = 0;
+	size_t memorypool_peak = 0;
+	size_t batch_memory = 0;
+	size_t batch_commands = 0;
+	size_t batch_peak_commands = 0;
 
 	std::vector<DrawerCommand *> commands;
 
@@ -194,6 +205,9 @@ public:
 	// Allocate memory valid for the duration of a command execution
 	static void* AllocMemory(size_t size);
 
+	// Memory and command counts for stat drawerqueue
+	static FString GetStats();
+
 	// Queue command to be executed by drawer worker threads
 	template<typename T, typename... Types>
 	static void QueueCommand(Types &&... args)
@@ -217,13 +231,6 @@ public:
 		else
 		{
 			void *ptr = AllocMemory(sizeof(T));
-			if (!ptr) // Out of memory - render what we got
-			{
-				queue->Finish();
-				ptr = AllocMemory(sizeof(T));
-				if (!ptr)
-					return;
-			}
 			T *command = new (ptr)T(std::forward<Types>(args)...);
 			queue->commands.push_back(command);
 		}
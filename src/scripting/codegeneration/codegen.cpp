@@ -7977,6 +7977,11 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 	VMFunction *vmfunc = Function->Variants[0].Implementation;
 	bool staticcall = (vmfunc->Final || vmfunc->VirtualIndex == ~0u || NoVirtual);
 
+	if (CanEmitNativeCall(build, vmfunc, staticcall))
+	{
+		return EmitNativeCall(build, vmfunc);
+	}
+
 	count = 0;
 	// Emit code to pass implied parameters
 	ExpEmit selfemit;
@@ -8069,6 +8074,19 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 		}
 	}
 handlereturns:
+	return EmitResults(build, vmfunc);
+}
+
+//==========================================================================
+//
+// FxVMFunctionCall :: EmitResults
+//
+// Emits the RESULT instructions that follow a call.
+//
+//==========================================================================
+
+ExpEmit FxVMFunctionCall::EmitResults(VMFunctionBuilder *build, VMFunction *vmfunc)
+{
 	if (AssignCount == 0)
 	{
 		// Regular call, will not write to ReturnRegs
@@ -8090,6 +8108,124 @@ handlereturns:
 	}
 }
 
+//==========================================================================
+//
+// FxVMFunctionCall :: CanEmitNativeCall
+//
+// Natives that were defined with DEFINE_ACTION_FUNCTION_NATIVE can be
+// called with CALLN, which lets them read their arguments straight from
+// our registers. That only works for plain numbers and pointers, and not
+// for anything that has to go through a virtual table.
+//
+//==========================================================================
+
+static bool IsDirectArgType(PType *type)
+{
+	int regtype = type->GetRegType();
+	return (regtype == REGT_INT || regtype == REGT_FLOAT || regtype == REGT_POINTER) && type->GetRegCount() == 1;
+}
+
+bool FxVMFunctionCall::CanEmitNativeCall(VMFunctionBuilder *build, VMFunction *vmfunc, bool staticcall)
+{
+	auto &variant = Function->Variants[0];
+
+	if (EmitTail || !vmfunc->Native || static_cast<VMNativeFunction *>(vmfunc)->DirectCall == nullptr)
+	{
+		return false;
+	}
+	if (variant.Flags & VARF_Action)
+	{
+		return false;
+	}
+	if ((variant.Flags & VARF_Method) && (!staticcall || !Self->ValueType->IsKindOf(RUNTIME_CLASS(PPointer))))
+	{
+		return false;
+	}
+	if (vmfunc->Proto->ReturnTypes.Size() > 1 || (vmfunc->Proto->ReturnTypes.Size() == 1 && !IsDirectArgType(vmfunc->Proto->ReturnTypes[0])))
+	{
+		return false;
+	}
+	for (auto arg : ArgList)
+	{
+		if (!IsDirectArgType(arg->ValueType))
+		{
+			return false;
+		}
+	}
+	// CALLN has no variant that takes the function from a register.
+	return build->GetConstantAddress(vmfunc, ATAG_OBJECT) <= 255;
+}
+
+//==========================================================================
+//
+// FxVMFunctionCall :: EmitNativeCall
+//
+// All arguments are evaluated first and then listed in the ARG instructions
+// following the CALLN. Since they are only read when the call is made, a
+// local variable must be copied if a later argument might still change it.
+//
+//==========================================================================
+
+ExpEmit FxVMFunctionCall::EmitNativeCall(VMFunctionBuilder *build, VMFunction *vmfunc)
+{
+	static const int loadops[] = { OP_LK, OP_LKF, OP_LKS, OP_LKP };
+	static const int moveops[] = { OP_MOVE, OP_MOVEF, OP_MOVES, OP_MOVEA };
+	TArray<ExpEmit> args;
+
+	if (Function->Variants[0].Flags & VARF_Method)
+	{
+		args.Push(Self->Emit(build));
+	}
+	for (unsigned i = 0; i < ArgList.Size(); ++i)
+	{
+		ExpEmit where = ArgList[i]->Emit(build);
+		if (where.RegType == REGT_NIL)
+		{
+			ScriptPosition.Message(MSG_ERROR, "Attempted to pass a non-value");
+			where = ExpEmit(build->GetConstantInt(0), REGT_INT, true);
+		}
+		args.Push(where);
+	}
+	ArgList.DeleteAndClear();
+	ArgList.ShrinkToFit();
+
+	unsigned lastchange = 0;
+	for (unsigned i = 0; i < args.Size(); ++i)
+	{
+		if (!args[i].Konst) lastchange = i;
+	}
+	for (unsigned i = 0; i < args.Size(); ++i)
+	{
+		ExpEmit &arg = args[i];
+		if (arg.Konst && arg.RegNum > 255)
+		{
+			ExpEmit reg(build, arg.RegType);
+			build->Emit(loadops[arg.RegType], reg.RegNum, arg.RegNum);
+			arg = reg;
+		}
+		else if (arg.Fixed && i < lastchange && !(arg.RegType == REGT_POINTER && arg.RegNum < build->NumImplicits))
+		{
+			ExpEmit reg(build, arg.RegType);
+			build->Emit(moveops[arg.RegType], reg.RegNum, arg.RegNum);
+			arg = reg;
+		}
+	}
+
+	int funcaddr = build->GetConstantAddress(vmfunc, ATAG_OBJECT);
+	int numret = vmfunc->Proto->ReturnTypes.Size() > 0 ? MAX(1, AssignCount) : 0;
+	build->Emit(OP_CALLN, funcaddr, args.Size(), numret);
+	for (auto &arg : args)
+	{
+		build->Emit(OP_ARG, 0, EncodeRegType(arg), arg.RegNum);
+		arg.Free(build);
+	}
+	if (numret == 0)
+	{
+		return ExpEmit();
+	}
+	return EmitResults(build, vmfunc);
+}
+
 //==========================================================================
 //
 // If calling one of the casting kludge functions, don't bother calling the
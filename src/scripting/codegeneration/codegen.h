@@ -1619,6 +1619,9 @@ public:
 	PPrototype *ReturnProto();
 	VMFunction *GetDirectFunction();
 	ExpEmit Emit(VMFunctionBuilder *build);
+	bool CanEmitNativeCall(VMFunctionBuilder *build, VMFunction *vmfunc, bool staticcall);
+	ExpEmit EmitNativeCall(VMFunctionBuilder *build, VMFunction *vmfunc);
+	ExpEmit EmitResults(VMFunctionBuilder *build, VMFunction *vmfunc);
 	bool CheckEmitCast(VMFunctionBuilder *build, bool returnit, ExpEmit &reg);
 	TArray<PType*> &GetReturnTypes() const
 	{
@@ -1146,6 +1146,8 @@ static void ParseDamageDefinition(FScanner &sc)
 
 void ParseDecorate (FScanner &sc)
 {
+	FunctionBuildList.AddSourceLump(sc.LumpNum);
+
 	// Get actor class name.
 	for(;;)
 	{
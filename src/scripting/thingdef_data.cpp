@@ -803,6 +803,7 @@ void InitThingdef()
 			assert(afunc->VMPointer != NULL);
 			*(afunc->VMPointer) = new VMNativeFunction(afunc->Function, afunc->FuncName);
 			(*(afunc->VMPointer))->PrintableName.Format("%s.%s [Native]", afunc->ClassName+1, afunc->FuncName);
+			(*(afunc->VMPointer))->DirectCall = afunc->DirectCall;
 			AFTable.Push(*afunc);
 		}
 		AFTable.ShrinkToFit();
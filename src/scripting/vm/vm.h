@@ -6,6 +6,7 @@
 #include "vectors.h"
 #include "cmdlib.h"
 #include "doomerrors.h"
+#include <utility>
 
 #define MAX_RETURNS		8	// Maximum number of results a function called by script code can return
 #define MAX_TRY_DEPTH	8	// Maximum number of nested TRYs in a single function
@@ -820,6 +821,12 @@ union FVoidObj
 	void *v;
 };
 
+// Native code for a script function, entered at instruction start. Returns
+// the index of the instruction where the interpreter has to continue.
+typedef int (*VMJitFunc)(int *d, double *f, int start);
+
+struct VMProfileInfo;
+
 struct FStatementInfo
 {
 	uint16_t InstructionIndex;
@@ -858,6 +865,10 @@ public:
 	VM_UHALF NumKonstA;
 	VM_UHALF MaxParam;		// Maximum number of parameters this function has on the stack at once
 	VM_UBYTE NumArgs;		// Number of arguments this function takes
+	VMJitFunc JitFunc;		// Native code for this function, if it has been compiled
+	uint8_t *JitNative;		// One entry per instruction, nonzero if it has native code
+	int JitCalls;			// Number of calls so far, or -1 if it cannot be compiled
+	VMProfileInfo *ProfileData;	// Only allocated once the function has been run by the profiler
 	TArray<FTypeAndOffset> SpecialInits;	// list of all contents on the extra stack which require construction and destruction
 
 	void InitExtra(void *addr);
@@ -903,13 +914,18 @@ class VMNativeFunction : public VMFunction
 	DECLARE_CLASS(VMNativeFunction, VMFunction);
 public:
 	typedef int (*NativeCallType)(VMValue *param, TArray<VMValue> &defaultparam, int numparam, VMReturn *ret, int numret);
+	typedef int (*DirectCallType)(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP *args, int numargs, TArray<VMValue> &defaultparam, VMReturn *ret, int numret);
 
-	VMNativeFunction() : NativeCall(NULL) { Native = true; }
-	VMNativeFunction(NativeCallType call) : NativeCall(call) { Native = true; }
-	VMNativeFunction(NativeCallType call, FName name) : VMFunction(name), NativeCall(call) { Native = true; }
+	VMNativeFunction() : NativeCall(NULL), DirectCall(NULL) { Native = true; }
+	VMNativeFunction(NativeCallType call) : NativeCall(call), DirectCall(NULL) { Native = true; }
+	VMNativeFunction(NativeCallType call, FName name) : VMFunction(name), NativeCall(call), DirectCall(NULL) { Native = true; }
 
 	// Return value is the number of results.
 	NativeCallType NativeCall;
+
+	// Optional entry point used by OP_CALLN. It reads the arguments straight
+	// out of the caller's registers instead of a VMValue array.
+	DirectCallType DirectCall;
 };
 
 class VMParamFiller
@@ -971,6 +987,7 @@ extern thread_local VMFrameStack GlobalVMStack;
 void VMSelectEngine(EVMEngine engine);
 extern int (*VMExec)(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret);
 void VMFillParams(VMValue *params, VMFrame *callee, int numparam);
+int VMJitRun(VMScriptFunction *func, const VMRegisters &reg);
 
 void VMDumpConstants(FILE *out, const VMScriptFunction *func);
 void VMDisasm(FILE *out, const VMOP *code, int codesize, const VMScriptFunction *func);
@@ -1063,6 +1080,110 @@ void NullParam(const char *varname);
 
 typedef int(*actionf_p)(VMValue *param, TArray<VMValue> &defaultparam, int numparam, VMReturn *ret, int numret);/*(VM_ARGS)*/
 
+//==========================================================================
+//
+// VMDirectCall
+//
+// Generates the DirectCall entry point for a native function from its
+// C++ signature. Each argument is read from the register or constant named
+// by the matching OP_ARG instruction, and arguments the caller left out
+// come from the function's defaults, like the PARAM_*_DEF macros do.
+//
+//==========================================================================
+
+template<class T> struct VMDirectArg;
+
+template<> struct VMDirectArg<int>
+{
+	static int Get(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP &arg)
+	{
+		return (arg.b & REGT_KONST) ? caller->KonstD[arg.c] : reg.d[arg.c];
+	}
+	static int Get(const VMValue &def) { return def.i; }
+};
+
+template<> struct VMDirectArg<bool>
+{
+	static bool Get(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP &arg)
+	{
+		return !!VMDirectArg<int>::Get(reg, caller, arg);
+	}
+	static bool Get(const VMValue &def) { return !!def.i; }
+};
+
+template<> struct VMDirectArg<double>
+{
+	static double Get(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP &arg)
+	{
+		return (arg.b & REGT_KONST) ? caller->KonstF[arg.c] : reg.f[arg.c];
+	}
+	static double Get(const VMValue &def) { return def.f; }
+};
+
+template<class T> struct VMDirectArg<T *>
+{
+	static T *Get(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP &arg)
+	{
+		return (T *)((arg.b & REGT_KONST) ? caller->KonstA[arg.c].v : reg.a[arg.c]);
+	}
+	static T *Get(const VMValue &def) { return (T *)def.a; }
+};
+
+template<class T> struct VMDirectResult
+{
+	static void Set(VMReturn *ret, T val) { ret->SetInt(val); }
+};
+
+template<> struct VMDirectResult<double>
+{
+	static void Set(VMReturn *ret, double val) { ret->SetFloat(val); }
+};
+
+template<class T> struct VMDirectResult<T *>
+{
+	static void Set(VMReturn *ret, T *val) { ret->SetPointer(val, ATAG_OBJECT); }
+};
+
+template<class F, F func> struct VMDirectCall;
+
+template<class R, class... Args, R (*func)(Args...)>
+struct VMDirectCall<R (*)(Args...), func>
+{
+	template<size_t... I>
+	static R Invoke(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP *args, int numargs, TArray<VMValue> &defaultparam, std::index_sequence<I...>)
+	{
+		return func(((int)I < numargs ? VMDirectArg<Args>::Get(reg, caller, args[I]) : VMDirectArg<Args>::Get(defaultparam[I]))...);
+	}
+
+	static int Call(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP *args, int numargs, TArray<VMValue> &defaultparam, VMReturn *ret, int numret)
+	{
+		R val = Invoke(reg, caller, args, numargs, defaultparam, std::index_sequence_for<Args...>());
+		if (numret > 0)
+		{
+			assert(ret != nullptr);
+			VMDirectResult<R>::Set(ret, val);
+			return 1;
+		}
+		return 0;
+	}
+};
+
+template<class... Args, void (*func)(Args...)>
+struct VMDirectCall<void (*)(Args...), func>
+{
+	template<size_t... I>
+	static void Invoke(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP *args, int numargs, TArray<VMValue> &defaultparam, std::index_sequence<I...>)
+	{
+		func(((int)I < numargs ? VMDirectArg<Args>::Get(reg, caller, args[I]) : VMDirectArg<Args>::Get(defaultparam[I]))...);
+	}
+
+	static int Call(const VMRegisters &reg, const VMScriptFunction *caller, const VMOP *args, int numargs, TArray<VMValue> &defaultparam, VMReturn *ret, int numret)
+	{
+		Invoke(reg, caller, args, numargs, defaultparam, std::index_sequence_for<Args...>());
+		return 0;
+	}
+};
+
 struct FieldDesc
 {
 	const char *ClassName;
@@ -1078,6 +1199,7 @@ struct AFuncDesc
 	const char *FuncName;
 	actionf_p Function;
 	VMNativeFunction **VMPointer;
+	VMNativeFunction::DirectCallType DirectCall;
 };
 
 #if defined(_MSC_VER)
@@ -1106,6 +1228,18 @@ struct AFuncDesc
 	MSVC_ASEG AFuncDesc const *const cls##_##name##_HookPtr GCC_ASEG = &cls##_##name##_Hook; \
 	static int AF_##cls##_##name(VM_ARGS)
 
+// Like DEFINE_ACTION_FUNCTION, but script code may also call native directly
+// through OP_CALLN, without boxing the arguments. native must be a plain
+// function that takes self (if any) and the script arguments in order, and
+// that can only take and return ints, bools, doubles and pointers.
+#define DEFINE_ACTION_FUNCTION_NATIVE(cls, name, native) \
+	static int AF_##cls##_##name(VM_ARGS); \
+	VMNativeFunction *cls##_##name##_VMPtr; \
+	static const AFuncDesc cls##_##name##_Hook = { #cls, #name, AF_##cls##_##name, &cls##_##name##_VMPtr, VMDirectCall<decltype(&native), &native>::Call }; \
+	extern AFuncDesc const *const cls##_##name##_HookPtr; \
+	MSVC_ASEG AFuncDesc const *const cls##_##name##_HookPtr GCC_ASEG = &cls##_##name##_Hook; \
+	static int AF_##cls##_##name(VM_ARGS)
+
 // cls is the scripted class name, icls the internal one (e.g. player_t vs. Player)
 #define DEFINE_FIELD_X(cls, icls, name) \
 	static const FieldDesc VMField_##icls##_##name = { "A" #cls, #name, (unsigned)myoffsetof(icls, name), (unsigned)sizeof(icls::name), 0 }; \
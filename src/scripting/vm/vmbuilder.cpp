@@ -61,6 +61,7 @@ VMFunctionBuilder::VMFunctionBuilder(int numimplicits)
 	MaxParam = 0;
 	ActiveParam = 0;
 	NumImplicits = numimplicits;
+	NumOptimized = 0;
 }
 
 //==========================================================================
@@ -107,8 +108,210 @@ void VMFunctionBuilder::EndStatement()
 	}
 }
 
+//==========================================================================
+//
+// IsConditionalSkip
+//
+// Instructions that may skip over the next one. For comparisons, the next
+// instruction is always the JMP that is taken when the test succeeds.
+//
+//==========================================================================
+
+static bool IsConditionalSkip(int op)
+{
+	switch (op)
+	{
+	case OP_TEST:	case OP_TESTN:	case OP_CMPS:	case OP_CATCH:
+	case OP_EQ_R:	case OP_EQ_K:
+	case OP_LT_RR:	case OP_LT_RK:	case OP_LT_KR:
+	case OP_LE_RR:	case OP_LE_RK:	case OP_LE_KR:
+	case OP_LTU_RR:	case OP_LTU_RK:	case OP_LTU_KR:
+	case OP_LEU_RR:	case OP_LEU_RK:	case OP_LEU_KR:
+	case OP_EQF_R:	case OP_EQF_K:
+	case OP_LTF_RR:	case OP_LTF_RK:	case OP_LTF_KR:
+	case OP_LEF_RR:	case OP_LEF_RK:	case OP_LEF_KR:
+	case OP_EQV2_R:	case OP_EQV2_K:
+	case OP_EQV3_R:	case OP_EQV3_K:
+	case OP_EQA_R:	case OP_EQA_K:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static bool IsFinalReturn(const VMOP &op)
+{
+	return (op.op == OP_RET && (op.b == REGT_NIL || (op.a & RET_FINAL))) || (op.op == OP_RETI && (op.a & RET_FINAL));
+}
+
+//==========================================================================
+//
+// VMFunctionBuilder :: Optimize
+//
+// Cleans up the code emitted by the tree-walking code generator before it
+// gets copied into the function:
+//
+// - Jumps to jumps are threaded to the final destination.
+// - Unconditional jumps to a return are replaced by that return.
+// - Code that cannot be reached is removed, and so are NOPs, jumps to the
+//   next instruction and moves of a register onto itself.
+//
+// The JMP after a comparison and the jump table after an IJMP are part of
+// the instruction that uses them, so they are never removed or replaced.
+//
+//==========================================================================
+
+void VMFunctionBuilder::Optimize()
+{
+	int numops = Code.Size();
+	if (numops == 0)
+	{
+		return;
+	}
+
+	TArray<bool> pinned, keep;
+	pinned.Resize(numops);
+	keep.Resize(numops);
+	for (int i = 0; i < numops; i++)
+	{
+		int op = Code[i].op;
+		// Exception handlers keep instruction addresses of their own.
+		if (op == OP_TRY || op == OP_UNTRY || op == OP_CATCH || (op == OP_IJMP && Code[i].i16 != 0))
+		{
+			return;
+		}
+		pinned[i] = i > 0 && IsConditionalSkip(Code[i - 1].op);
+		keep[i] = false;
+	}
+	for (int i = 0; i < numops; i++)
+	{
+		if (Code[i].op == OP_IJMP)
+		{
+			for (int j = i + 1; j < numops && Code[j].op == OP_JMP; j++)
+			{
+				pinned[j] = true;
+			}
+		}
+	}
+
+	// Thread jumps and pull returns forward.
+	for (int i = 0; i < numops; i++)
+	{
+		if (Code[i].op != OP_JMP)
+		{
+			continue;
+		}
+		int target = i + 1 + Code[i].i24;
+		for (int hops = 0; hops < numops && target < numops && Code[target].op == OP_JMP; hops++)
+		{
+			target = target + 1 + Code[target].i24;
+		}
+		Code[i].i24 = target - i - 1;
+		if (!pinned[i] && target < numops && IsFinalReturn(Code[target]))
+		{
+			Code[i] = Code[target];
+		}
+	}
+
+	// Find everything that is reachable from the entry point.
+	TArray<int> work;
+	work.Push(0);
+	while (work.Size() > 0)
+	{
+		int i;
+		work.Pop(i);
+		if (i >= numops || keep[i])
+		{
+			continue;
+		}
+		keep[i] = true;
+
+		const VMOP &op = Code[i];
+		if (op.op == OP_JMP)
+		{
+			work.Push(i + 1 + op.i24);
+		}
+		else if (op.op == OP_IJMP)
+		{
+			for (int j = i + 1; j < numops && Code[j].op == OP_JMP; j++)
+			{
+				work.Push(j);
+			}
+		}
+		else if (IsConditionalSkip(op.op))
+		{
+			work.Push(i + 1);
+			work.Push(i + 2);
+		}
+		else if (!IsFinalReturn(op) && op.op != OP_TAIL && op.op != OP_TAIL_K && op.op != OP_THROW)
+		{
+			work.Push(i + 1);
+		}
+	}
+
+	// Instructions that do nothing can go as well.
+	for (int i = 0; i < numops; i++)
+	{
+		if (!keep[i] || pinned[i]) continue;
+		const VMOP &op = Code[i];
+		if (op.op == OP_NOP || (op.op == OP_JMP && op.i24 == 0) ||
+			((op.op == OP_MOVE || op.op == OP_MOVEF || op.op == OP_MOVES || op.op == OP_MOVEA) && op.a == op.b))
+		{
+			keep[i] = false;
+		}
+	}
+
+	// Build the mapping from old to new addresses. A removed instruction maps to
+	// the next one that is kept, which is where control would have ended up.
+	TArray<int> remap;
+	remap.Resize(numops + 1);
+	int newcount = 0;
+	for (int i = 0; i < numops; i++)
+	{
+		remap[i] = newcount;
+		if (keep[i]) newcount++;
+	}
+	remap[numops] = newcount;
+	if (newcount == numops)
+	{
+		return;
+	}
+
+	for (int i = 0, j = 0; i < numops; i++)
+	{
+		if (!keep[i]) continue;
+		VMOP op = Code[i];
+		if (op.op == OP_JMP)
+		{
+			op.i24 = remap[i + 1 + op.i24] - j - 1;
+		}
+		Code[j++] = op;
+	}
+	Code.Resize(newcount);
+
+	// Statements that lost all their code are dropped from the line table.
+	unsigned k = 0;
+	for (unsigned i = 0; i < LineNumbers.Size(); i++)
+	{
+		FStatementInfo si = LineNumbers[i];
+		si.InstructionIndex = (uint16_t)remap[si.InstructionIndex];
+		if (k > 0 && LineNumbers[k - 1].InstructionIndex == si.InstructionIndex)
+		{
+			LineNumbers[k - 1] = si;
+		}
+		else
+		{
+			LineNumbers[k++] = si;
+		}
+	}
+	LineNumbers.Resize(k);
+	NumOptimized += numops - newcount;
+}
+
 void VMFunctionBuilder::MakeFunction(VMScriptFunction *func)
 {
+	Optimize();
 	func->Alloc(Code.Size(), IntConstantList.Size(), FloatConstantList.Size(), StringConstantList.Size(), AddressConstantList.Size(), LineNumbers.Size());
 
 	// Copy code block.
@@ -844,14 +1047,30 @@ void FFunctionBuildList::Build()
 {
 	int errorcount = 0;
 	int codesize = 0;
+	int optimized = 0;
 	FILE *dump = nullptr;
 
 	if (Args->CheckParm("-dumpdisasm")) dump = fopen("disasm.txt", "w");
 
-	for (auto &item : mItems)
+	Cache.Begin(mItems.Size());
+	for (unsigned i = 0; i < mItems.Size(); i++)
 	{
+		auto &item = mItems[i];
 		assert(item.Code != NULL);
 
+		if (Cache.Load(i, item.PrintableName, item.Func, item.Function))
+		{
+			if (dump != nullptr)
+			{
+				DumpFunction(dump, item.Function, item.PrintableName.GetChars(), (int)item.PrintableName.Len());
+				codesize += item.Function->CodeSize;
+				fflush(dump);
+			}
+			delete item.Code;
+			continue;
+		}
+		Cache.BeginItem();
+
 		// We don't know the return type in advance for anonymous functions.
 		FCompileContext ctx(item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump);
 
@@ -924,8 +1143,10 @@ void FFunctionBuildList::Build()
 				{
 					DumpFunction(dump, sfunc, item.PrintableName.GetChars(), (int)item.PrintableName.Len());
 					codesize += sfunc->CodeSize;
+					optimized += buildit.NumOptimized;
 				}
 				sfunc->Unsafe = ctx.Unsafe;
+				Cache.Store(i, item.PrintableName, item.Func, sfunc);
 			}
 			catch (CRecoverableError &err)
 			{
@@ -941,10 +1162,11 @@ void FFunctionBuildList::Build()
 	}
 	if (dump != nullptr)
 	{
-		fprintf(dump, "\n*************************************************************************\n%i code bytes\n", codesize * 4);
+		fprintf(dump, "\n*************************************************************************\n%i code bytes (%i bytes removed by the optimizer)\n", codesize * 4, optimized * 4);
 		fclose(dump);
 	}
 	FScriptPosition::StrictErrors = false;
+	Cache.End(FScriptPosition::ErrorCounter == 0);
 	mItems.Clear();
 	FxAlloc.FreeAllBlocks();
 }
\ No newline at end of file
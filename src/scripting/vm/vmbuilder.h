@@ -93,6 +93,9 @@ public:
 	// keep the frame pointer, if needed, in a register because the LFP opcode is hideously inefficient, requiring more than 20 instructions on x64.
 	ExpEmit FramePointer;
 
+	// Number of instructions removed by Optimize.
+	int NumOptimized;
+
 private:
 	struct AddrKonst
 	{
@@ -119,11 +122,59 @@ private:
 
 	TArray<VMOP> Code;
 
+	void Optimize();
+
 };
 
 void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int labellen);
 
 
+//==========================================================================
+//
+// FScriptCodeCache
+//
+// Keeps the code that FFunctionBuildList::Build emits in the user's cache
+// directory, keyed by the contents of every script lump, so that a set of
+// scripts that hasn't changed doesn't have to be compiled again.
+//
+//==========================================================================
+
+struct FCodeCacheReloc
+{
+	BYTE Kind;
+	FString Owner;
+	FString Name;
+	int Index;
+};
+
+class FScriptCodeCache
+{
+	TArray<int> SourceLumps;
+	TArray<TArray<BYTE>> Records;
+	TMap<void *, FCodeCacheReloc> Relocs;
+	BYTE Key[16];
+	int StartNames;
+	unsigned LabelStart;
+	int ErrorStart, WarnStart;
+	bool Valid;
+	bool Dirty;
+	bool RelocsBuilt;
+
+	void ComputeKey();
+	bool ReadFile();
+	void WriteFile();
+	void BuildRelocs();
+	bool FindReloc(void *ptr, VM_ATAG tag, FCodeCacheReloc &reloc);
+
+public:
+	void AddSourceLump(int lump) { SourceLumps.Push(lump); }
+	void Begin(unsigned numitems);
+	bool Load(unsigned index, const FString &name, PFunction *func, VMScriptFunction *sfunc);
+	void BeginItem();
+	void Store(unsigned index, const FString &name, PFunction *func, VMScriptFunction *sfunc);
+	void End(bool success);
+};
+
 //==========================================================================
 //
 //
@@ -147,9 +198,11 @@ class FFunctionBuildList
 	};
 
 	TArray<Item> mItems;
+	FScriptCodeCache Cache;
 
 public:
 	VMFunction *AddFunction(PFunction *func, FxExpression *code, const FString &name, bool fromdecorate, int currentstate, int statecnt, int lumpnum);
+	void AddSourceLump(int lump) { Cache.AddSourceLump(lump); }
 	void Build();
 };
 
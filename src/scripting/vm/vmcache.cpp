@@ -0,0 +1,1029 @@
+/*
+** vmcache.cpp
+** Keeps compiled script code on disk between runs
+**
+**---------------------------------------------------------------------------
+** Copyright 2016 The ZDoom Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The cache file holds one record per entry of the function build list.
+** A record can only be used if everything the compiler would have looked
+** up produces the same result, so the key covers the script sources, the
+** name table and the sound table, and every address constant is written
+** as a description of what it points to instead of the pointer itself.
+** Functions whose compilation had side effects that can't be replayed are
+** simply not cached.
+**
+*/
+
+#include "vmbuilder.h"
+#include "dobjtype.h"
+#include "info.h"
+#include "c_cvars.h"
+#include "m_random.h"
+#include "s_sound.h"
+#include "sc_man.h"
+#include "w_wad.h"
+#include "md5.h"
+#include "m_misc.h"
+#include "cmdlib.h"
+#include "version.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+CVAR(Bool, vm_codecache, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+extern FBaseCVar *CVars;
+
+static const char CodeCacheMagic[4] = { 'Z', 'S', 'C', '1' };
+
+enum
+{
+	MAX_CODECACHE_FILES = 8,	// one file per set of scripts
+};
+
+// What an address constant points to.
+enum
+{
+	CR_Null,
+	CR_Int,			// small integer stored as a pointer, e.g. a member offset
+	CR_Class,		// Name
+	CR_Function,	// Owner's symbol Name, variant Index or -1 for a PSymbolVMFunction
+	CR_Field,		// Owner's static field Name
+	CR_State,		// Owner's state Index
+	CR_RNG,			// CRC in Index
+	CR_CVar,		// Name, real type in the upper 16 bits of Index and offset into the object in the lower
+};
+
+//==========================================================================
+//
+// Serialization helpers. The cache is local to this machine, so byte
+// order doesn't matter here.
+//
+//==========================================================================
+
+class FCodeCacheWriter
+{
+public:
+	FCodeCacheWriter(TArray<BYTE> &data) : Data(data) {}
+
+	void Bytes(const void *buf, unsigned len)
+	{
+		if (len > 0)
+		{
+			unsigned pos = Data.Reserve(len);
+			memcpy(&Data[pos], buf, len);
+		}
+	}
+	void Int(int val) { Bytes(&val, sizeof(val)); }
+	void String(const char *str)
+	{
+		unsigned len = (unsigned)strlen(str);
+		Int(len);
+		Bytes(str, len);
+	}
+
+private:
+	TArray<BYTE> &Data;
+};
+
+class FCodeCacheReader
+{
+public:
+	FCodeCacheReader(const BYTE *data, unsigned len) : Ok(true), Pos(data), End(data + len) {}
+
+	bool Bytes(void *buf, unsigned len)
+	{
+		if (!Ok || unsigned(End - Pos) < len)
+		{
+			Ok = false;
+			return false;
+		}
+		if (len > 0) memcpy(buf, Pos, len);
+		Pos += len;
+		return true;
+	}
+	int Int()
+	{
+		int val = 0;
+		Bytes(&val, sizeof(val));
+		return val;
+	}
+	// Reads an element count and checks that there is enough data left for it.
+	unsigned Count(unsigned elemsize)
+	{
+		unsigned count = Int();
+		if (!Ok || unsigned(End - Pos) / elemsize < count)
+		{
+			Ok = false;
+			return 0;
+		}
+		return count;
+	}
+	FString String()
+	{
+		unsigned len = Count(1);
+		FString str((const char *)Pos, len);
+		Pos += len;
+		return str;
+	}
+	bool AtEnd() const { return Ok && Pos == End; }
+
+	bool Ok;
+
+private:
+	const BYTE *Pos, *End;
+};
+
+//==========================================================================
+//
+// The return types an anonymous function's prototype can be recreated
+// from. Anything else isn't cached.
+//
+//==========================================================================
+
+static PType *CacheableType(unsigned index)
+{
+	PType *const types[] = { TypeSInt32, TypeUInt32, TypeBool, TypeFloat64, TypeString, TypeName,
+		TypeSound, TypeColor, TypeState, TypeVector2, TypeVector3, TypeSpriteID, TypeTextureID };
+	return index < countof(types) ? types[index] : nullptr;
+}
+
+static int CacheableTypeIndex(PType *type)
+{
+	PType *check;
+	for (unsigned i = 0; (check = CacheableType(i)) != nullptr; i++)
+	{
+		if (check == type) return i;
+	}
+	return -1;
+}
+
+static size_t CVarSize(ECVarType type)
+{
+	switch (type)
+	{
+	case CVAR_Bool:		return sizeof(FBoolCVar);
+	case CVAR_Int:		return sizeof(FIntCVar);
+	case CVAR_Float:	return sizeof(FFloatCVar);
+	case CVAR_String:	return sizeof(FStringCVar);
+	case CVAR_Color:	return sizeof(FColorCVar);
+	default:			return 0;
+	}
+}
+
+//==========================================================================
+//
+// Cache file names
+//
+//==========================================================================
+
+static FString CodeCachePath(bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/scripts";
+	if (create) CreatePath(path);
+	path << '/';
+	return path;
+}
+
+static FString CodeCacheName(const BYTE key[16], bool create)
+{
+	FString path = CodeCachePath(create);
+	for (int i = 0; i < 16; i++)
+	{
+		path.AppendFormat("%02x", key[i]);
+	}
+	path << ".zsc";
+	return path;
+}
+
+//==========================================================================
+//
+// TrimCodeCache
+//
+// Every different set of loaded scripts gets its own file, so only keep
+// the most recently written ones.
+//
+//==========================================================================
+
+struct FCodeCacheFile
+{
+	FString Filename;
+	time_t Time;
+};
+
+static int SortCodeCacheFiles(const void *a, const void *b)
+{
+	time_t ta = ((const FCodeCacheFile *)a)->Time;
+	time_t tb = ((const FCodeCacheFile *)b)->Time;
+	return ta < tb ? -1 : ta > tb ? 1 : 0;
+}
+
+static void TrimCodeCache()
+{
+	TArray<FFileList> list;
+	TArray<FCodeCacheFile> files;
+
+	try
+	{
+		ScanDirectory(list, CodeCachePath(false));
+	}
+	catch (CRecoverableError &)
+	{
+		return;
+	}
+
+	for (unsigned i = 0; i < list.Size(); i++)
+	{
+		struct stat info;
+		if (!list[i].isDirectory && stat(list[i].Filename, &info) == 0)
+		{
+			FCodeCacheFile file = { list[i].Filename, info.st_mtime };
+			files.Push(file);
+		}
+	}
+	if (files.Size() > MAX_CODECACHE_FILES)
+	{
+		qsort(&files[0], files.Size(), sizeof(files[0]), SortCodeCacheFiles);
+		for (unsigned i = 0; i < files.Size() - MAX_CODECACHE_FILES; i++)
+		{
+			remove(files[i].Filename);
+		}
+	}
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: ComputeKey
+//
+// The code depends on the script sources and on everything the compiler
+// turns into plain numbers: name indices, sound indices and colors. Where
+// a lump comes from matters too, because scripts outside the IWAD are
+// not allowed to write to read-only data.
+//
+//==========================================================================
+
+static void AddLumpToCodeKey(MD5Context &md5, int lumpnum)
+{
+	const char *lumpname = Wads.GetLumpFullName(lumpnum);
+	int ident[2] = { Wads.GetLumpFile(lumpnum), Wads.LumpLength(lumpnum) };
+
+	md5.Update((const BYTE *)lumpname, (unsigned)strlen(lumpname) + 1);
+	md5.Update((const BYTE *)ident, sizeof(ident));
+	FWadLump lump = Wads.OpenLumpNum(lumpnum);
+	md5.Update(&lump, ident[1]);
+}
+
+void FScriptCodeCache::ComputeKey()
+{
+	MD5Context md5;
+	int lump, lastlump = 0;
+	BYTE ptrsize = sizeof(void *);
+
+	md5.Update((const BYTE *)CodeCacheMagic, sizeof(CodeCacheMagic));
+	md5.Update((const BYTE *)GetVersionString(), (unsigned)strlen(GetVersionString()) + 1);
+	md5.Update((const BYTE *)GetGitHash(), (unsigned)strlen(GetGitHash()) + 1);
+	md5.Update(&ptrsize, 1);
+
+	for (auto lumpnum : SourceLumps)
+	{
+		AddLumpToCodeKey(md5, lumpnum);
+	}
+	while ((lump = Wads.FindLump("CVARINFO", &lastlump)) != -1)
+	{
+		AddLumpToCodeKey(md5, lump);
+	}
+	if ((lump = Wads.CheckNumForName("X11R6RGB")) != -1)
+	{
+		AddLumpToCodeKey(md5, lump);
+	}
+	for (int i = 0; i < StartNames; i++)
+	{
+		const char *name = FName(ENamedName(i)).GetChars();
+		md5.Update((const BYTE *)name, (unsigned)strlen(name) + 1);
+	}
+	for (auto &sfx : S_sfx)
+	{
+		md5.Update((const BYTE *)sfx.name.GetChars(), sfx.name.Len() + 1);
+	}
+	md5.Final(Key);
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: ReadFile
+//
+// Names that were created while compiling are created again, in the
+// same order, before anything is loaded. If one of them doesn't get the
+// same index, the name table is different and nothing can be used.
+//
+//==========================================================================
+
+bool FScriptCodeCache::ReadFile()
+{
+	FILE *f = fopen(CodeCacheName(Key, false), "rb");
+	if (f == NULL) return false;
+
+	TArray<BYTE> data;
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (len > 0)
+	{
+		data.Resize((unsigned)len);
+		if (fread(&data[0], 1, len, f) != (size_t)len)
+		{
+			data.Clear();
+		}
+	}
+	fclose(f);
+	if (data.Size() == 0) return false;
+
+	FCodeCacheReader rd(&data[0], data.Size());
+	char magic[4];
+	BYTE filekey[16];
+
+	if (!rd.Bytes(magic, 4) || memcmp(magic, CodeCacheMagic, 4) ||
+		!rd.Bytes(filekey, 16) || memcmp(filekey, Key, 16) ||
+		rd.Int() != StartNames)
+	{
+		return false;
+	}
+	unsigned numnames = rd.Count(4);
+	for (unsigned i = 0; i < numnames && rd.Ok; i++)
+	{
+		FString name = rd.String();
+		if (rd.Ok && FName(name).GetIndex() != StartNames + (int)i)
+		{
+			return false;
+		}
+	}
+	if (rd.Int() != (int)Records.Size())
+	{
+		return false;
+	}
+	for (auto &record : Records)
+	{
+		unsigned len = rd.Count(1);
+		record.Resize(len);
+		if (len > 0) rd.Bytes(&record[0], len);
+	}
+	if (!rd.AtEnd())
+	{
+		for (auto &record : Records) record.Clear();
+		return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: WriteFile
+//
+//==========================================================================
+
+void FScriptCodeCache::WriteFile()
+{
+	TArray<BYTE> data;
+	FCodeCacheWriter wr(data);
+	int numnames = FName::GetNumNames();
+
+	wr.Bytes(CodeCacheMagic, 4);
+	wr.Bytes(Key, 16);
+	wr.Int(StartNames);
+	wr.Int(numnames - StartNames);
+	for (int i = StartNames; i < numnames; i++)
+	{
+		wr.String(FName(ENamedName(i)).GetChars());
+	}
+	wr.Int(Records.Size());
+	for (auto &record : Records)
+	{
+		wr.Int(record.Size());
+		if (record.Size() > 0) wr.Bytes(&record[0], record.Size());
+	}
+
+	FString path = CodeCacheName(Key, true);
+	FILE *f = fopen(path, "wb");
+	if (f != NULL)
+	{
+		bool ok = fwrite(&data[0], 1, data.Size(), f) == data.Size();
+		if (fclose(f) != 0 || !ok)
+		{
+			remove(path);
+		}
+		TrimCodeCache();
+	}
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: BuildRelocs
+//
+// Maps the addresses of all functions and static fields to their symbols.
+//
+//==========================================================================
+
+static void AddTableRelocs(TMap<void *, FCodeCacheReloc> &relocs, PSymbolTable &table, const char *owner)
+{
+	auto it = table.GetIterator();
+	PSymbolTable::MapType::Pair *pair;
+
+	while (it.NextPair(pair))
+	{
+		PSymbol *sym = pair->Value;
+		FCodeCacheReloc reloc = { CR_Function, owner, sym->SymbolName.GetChars(), -1 };
+
+		if (sym->IsKindOf(RUNTIME_CLASS(PFunction)))
+		{
+			auto func = static_cast<PFunction *>(sym);
+			for (unsigned i = 0; i < func->Variants.Size(); i++)
+			{
+				if (func->Variants[i].Implementation != nullptr)
+				{
+					reloc.Index = i;
+					relocs[func->Variants[i].Implementation] = reloc;
+				}
+			}
+		}
+		else if (sym->IsKindOf(RUNTIME_CLASS(PSymbolVMFunction)))
+		{
+			auto vmsym = static_cast<PSymbolVMFunction *>(sym);
+			if (vmsym->Function != nullptr)
+			{
+				relocs[vmsym->Function] = reloc;
+			}
+		}
+		else if (sym->IsKindOf(RUNTIME_CLASS(PField)))
+		{
+			auto field = static_cast<PField *>(sym);
+			if (field->Flags & VARF_Static)
+			{
+				reloc.Kind = CR_Field;
+				relocs[(void *)field->Offset] = reloc;
+			}
+		}
+	}
+}
+
+void FScriptCodeCache::BuildRelocs()
+{
+	AddTableRelocs(Relocs, GlobalSymbols, "");
+	for (auto cls : PClass::AllClasses)
+	{
+		AddTableRelocs(Relocs, cls->Symbols, cls->TypeName.GetChars());
+	}
+	RelocsBuilt = true;
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: FindReloc
+//
+// Describes an address constant. Returns false if it points to something
+// that can't be found again in the next run.
+//
+//==========================================================================
+
+bool FScriptCodeCache::FindReloc(void *ptr, VM_ATAG tag, FCodeCacheReloc &reloc)
+{
+	reloc.Owner = "";
+	reloc.Name = "";
+	reloc.Index = 0;
+
+	if (ptr == nullptr)
+	{
+		reloc.Kind = CR_Null;
+		return true;
+	}
+	if ((uintptr_t)ptr < 65536)
+	{
+		reloc.Kind = CR_Int;
+		reloc.Index = (int)(intptr_t)ptr;
+		return true;
+	}
+	if (tag == ATAG_RNG)
+	{
+		reloc.Kind = CR_RNG;
+		reloc.Index = (int)static_cast<FRandom *>(ptr)->GetCRC();
+		return reloc.Index != 0;
+	}
+
+	if (!RelocsBuilt) BuildRelocs();
+	auto found = Relocs.CheckKey(ptr);
+	if (found != nullptr)
+	{
+		reloc = *found;
+		return true;
+	}
+
+	if (tag == ATAG_OBJECT)
+	{
+		auto obj = static_cast<DObject *>(ptr);
+		if (obj->IsKindOf(RUNTIME_CLASS(PClass)))
+		{
+			reloc.Kind = CR_Class;
+			reloc.Name = static_cast<PClass *>(obj)->TypeName.GetChars();
+			return true;
+		}
+		if (obj->IsKindOf(RUNTIME_CLASS(VMFunction)))
+		{
+			// Builtins get added to the global symbols while compiling, after the map was made.
+			auto func = static_cast<VMFunction *>(obj);
+			auto sym = dyn_cast<PSymbolVMFunction>(GlobalSymbols.FindSymbol(func->Name, false));
+			if (sym != nullptr && sym->Function == func)
+			{
+				reloc.Kind = CR_Function;
+				reloc.Name = func->Name.GetChars();
+				reloc.Index = -1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	auto state = static_cast<FState *>(ptr);
+	PClassActor *owner = FState::StaticFindStateOwner(state);
+	if (owner != nullptr)
+	{
+		reloc.Kind = CR_State;
+		reloc.Owner = owner->TypeName.GetChars();
+		reloc.Index = int(state - owner->OwnedStates);
+		return true;
+	}
+
+	for (FBaseCVar *var = CVars; var != nullptr; var = var->GetNext())
+	{
+		ptrdiff_t offset = (BYTE *)ptr - (BYTE *)var;
+		if (offset >= 0 && (size_t)offset < CVarSize(var->GetRealType()))
+		{
+			reloc.Kind = CR_CVar;
+			reloc.Name = var->GetName();
+			reloc.Index = (var->GetRealType() << 16) | int(offset);
+			return true;
+		}
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// ResolveReloc
+//
+//==========================================================================
+
+static PSymbol *FindRelocSymbol(const FCodeCacheReloc &reloc)
+{
+	PSymbolTable *table = &GlobalSymbols;
+	if (reloc.Owner.IsNotEmpty())
+	{
+		PClass *cls = PClass::FindClass(reloc.Owner);
+		if (cls == nullptr) return nullptr;
+		table = &cls->Symbols;
+	}
+	FName name(reloc.Name, true);
+	return name == NAME_None ? nullptr : table->FindSymbol(name, false);
+}
+
+static bool ResolveReloc(const FCodeCacheReloc &reloc, void *&ptr)
+{
+	ptr = nullptr;
+	switch (reloc.Kind)
+	{
+	case CR_Null:
+		return true;
+
+	case CR_Int:
+		ptr = (void *)(intptr_t)reloc.Index;
+		return true;
+
+	case CR_Class:
+		ptr = PClass::FindClass(reloc.Name);
+		break;
+
+	case CR_Function:
+	{
+		PSymbol *sym = FindRelocSymbol(reloc);
+		if (reloc.Index >= 0)
+		{
+			auto func = dyn_cast<PFunction>(sym);
+			if (func != nullptr && (unsigned)reloc.Index < func->Variants.Size())
+			{
+				ptr = func->Variants[reloc.Index].Implementation;
+			}
+		}
+		else
+		{
+			auto vmsym = dyn_cast<PSymbolVMFunction>(sym);
+			if (vmsym != nullptr) ptr = vmsym->Function;
+		}
+		break;
+	}
+
+	case CR_Field:
+	{
+		auto field = dyn_cast<PField>(FindRelocSymbol(reloc));
+		if (field != nullptr && (field->Flags & VARF_Static))
+		{
+			ptr = (void *)field->Offset;
+		}
+		break;
+	}
+
+	case CR_State:
+	{
+		PClassActor *cls = PClass::FindActor(reloc.Owner);
+		if (cls != nullptr && reloc.Index >= 0 && reloc.Index < cls->NumOwnedStates)
+		{
+			ptr = cls->OwnedStates + reloc.Index;
+		}
+		break;
+	}
+
+	case CR_RNG:
+		ptr = FRandom::StaticFindRNGByCRC((DWORD)reloc.Index);
+		break;
+
+	case CR_CVar:
+	{
+		FBaseCVar *var = FindCVar(reloc.Name, nullptr);
+		if (var != nullptr && var->GetRealType() == (reloc.Index >> 16))
+		{
+			ptr = (BYTE *)var + (reloc.Index & 0xffff);
+		}
+		break;
+	}
+	}
+	return ptr != nullptr;
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: Begin
+//
+//==========================================================================
+
+void FScriptCodeCache::Begin(unsigned numitems)
+{
+	Records.Clear();
+	Relocs.Clear();
+	StartNames = FName::GetNumNames();
+	Valid = Dirty = RelocsBuilt = false;
+
+	// Scripts that didn't come from a lump can't be part of the key.
+	if (vm_codecache && numitems > 0 && SourceLumps.Find(-1) == SourceLumps.Size())
+	{
+		Records.Resize(numitems);
+		ComputeKey();
+		Valid = ReadFile();
+	}
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: Load
+//
+// Restores what Resolve and Emit would have produced for one function.
+// Nothing is changed unless the whole record could be used.
+//
+//==========================================================================
+
+struct FCodeCacheLabel
+{
+	FState *State;
+	TArray<FName> Names;
+};
+
+bool FScriptCodeCache::Load(unsigned index, const FString &name, PFunction *func, VMScriptFunction *sfunc)
+{
+	if (!Valid || index >= Records.Size() || Records[index].Size() == 0)
+	{
+		return false;
+	}
+
+	FCodeCacheReader rd(&Records[index][0], Records[index].Size());
+	if (rd.String().Compare(name) != 0 || (unsigned)rd.Int() != StateLabels.Storage.Size())
+	{
+		return false;
+	}
+
+	TArray<FCodeCacheLabel> labels;
+	unsigned numlabels = rd.Count(4);
+	labels.Resize(numlabels);
+	for (auto &label : labels)
+	{
+		unsigned numnames = rd.Count(4);
+		if (numnames == 0)
+		{
+			FCodeCacheReloc reloc;
+			reloc.Kind = CR_State;
+			reloc.Owner = rd.String();
+			reloc.Index = rd.Int();
+			void *ptr;
+			if (!rd.Ok || !ResolveReloc(reloc, ptr)) return false;
+			label.State = static_cast<FState *>(ptr);
+		}
+		else
+		{
+			label.State = nullptr;
+			for (unsigned i = 0; i < numnames; i++)
+			{
+				FName labelname = ENamedName(rd.Int());
+				if (!labelname.IsValidName()) return false;
+				label.Names.Push(labelname);
+			}
+		}
+	}
+
+	int extraspace = rd.Int();
+	bool isunsafe = !!rd.Int();
+	int numregs[4];
+	for (auto &num : numregs) num = rd.Int();
+	int maxparam = rd.Int();
+
+	TArray<PType *> rets;
+	int numrets = rd.Int();
+	if ((numrets >= 0) != (func->SymbolName == NAME_None))
+	{
+		return false;
+	}
+	for (int i = 0; i < numrets && rd.Ok; i++)
+	{
+		PType *type = CacheableType(rd.Int());
+		if (type == nullptr) return false;
+		rets.Push(type);
+	}
+
+	FString sourcefile = rd.String();
+
+	TArray<VMOP> code;
+	code.Resize(rd.Count(sizeof(VMOP)));
+	if (code.Size() == 0) return false;
+	rd.Bytes(&code[0], code.Size() * sizeof(VMOP));
+
+	TArray<FStatementInfo> lines;
+	lines.Resize(rd.Count(sizeof(FStatementInfo)));
+	if (lines.Size() > 0) rd.Bytes(&lines[0], lines.Size() * sizeof(FStatementInfo));
+
+	TArray<int> konstd;
+	konstd.Resize(rd.Count(sizeof(int)));
+	if (konstd.Size() > 0) rd.Bytes(&konstd[0], konstd.Size() * sizeof(int));
+
+	TArray<double> konstf;
+	konstf.Resize(rd.Count(sizeof(double)));
+	if (konstf.Size() > 0) rd.Bytes(&konstf[0], konstf.Size() * sizeof(double));
+
+	TArray<FString> konsts;
+	konsts.Resize(rd.Count(4));
+	for (auto &str : konsts) str = rd.String();
+
+	TArray<void *> konsta;
+	TArray<VM_ATAG> tags;
+	unsigned numkonsta = rd.Count(1);
+	for (unsigned i = 0; i < numkonsta && rd.Ok; i++)
+	{
+		FCodeCacheReloc reloc;
+		VM_ATAG tag;
+		void *ptr;
+
+		rd.Bytes(&tag, 1);
+		rd.Bytes(&reloc.Kind, 1);
+		reloc.Owner = rd.String();
+		reloc.Name = rd.String();
+		reloc.Index = rd.Int();
+		if (!rd.Ok || !ResolveReloc(reloc, ptr)) return false;
+		konsta.Push(ptr);
+		tags.Push(tag);
+	}
+
+	if (!rd.AtEnd() || lines.Size() > 65535 || konstd.Size() > 65535 || konstf.Size() > 65535 ||
+		konsts.Size() > 65535 || konsta.Size() > 65535)
+	{
+		return false;
+	}
+
+	// Everything checks out. Fill in the function.
+	sfunc->Alloc(code.Size(), konstd.Size(), konstf.Size(), konsts.Size(), konsta.Size(), lines.Size());
+	memcpy(sfunc->Code, &code[0], code.Size() * sizeof(VMOP));
+	if (lines.Size() > 0) memcpy(sfunc->LineInfo, &lines[0], lines.Size() * sizeof(FStatementInfo));
+	if (konstd.Size() > 0) memcpy(sfunc->KonstD, &konstd[0], konstd.Size() * sizeof(int));
+	if (konstf.Size() > 0) memcpy(sfunc->KonstF, &konstf[0], konstf.Size() * sizeof(double));
+	for (unsigned i = 0; i < konsts.Size(); i++)
+	{
+		sfunc->KonstS[i] = konsts[i];
+	}
+	for (unsigned i = 0; i < konsta.Size(); i++)
+	{
+		sfunc->KonstA[i].v = konsta[i];
+		sfunc->KonstATags()[i] = tags[i];
+	}
+	sfunc->NumRegD = numregs[0];
+	sfunc->NumRegF = numregs[1];
+	sfunc->NumRegS = numregs[2];
+	sfunc->NumRegA = numregs[3];
+	sfunc->MaxParam = maxparam;
+	sfunc->ExtraSpace = extraspace;
+	sfunc->Unsafe = isunsafe;
+	sfunc->SourceFileName = sourcefile;
+
+	if (sfunc->Proto == nullptr)
+	{
+		sfunc->Proto = NewPrototype(rets, func->Variants[0].Proto->ArgumentTypes);
+	}
+	sfunc->NumArgs = 0;
+	for (auto s : func->Variants[0].Proto->ArgumentTypes)
+	{
+		sfunc->NumArgs += s->GetRegCount();
+	}
+
+	// The code refers to these by their position in the label storage.
+	for (auto &label : labels)
+	{
+		if (label.State != nullptr) StateLabels.AddPointer(label.State);
+		else StateLabels.AddNames(label.Names);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: BeginItem
+//
+// Called before a function gets compiled, to see what compiling it did.
+//
+//==========================================================================
+
+void FScriptCodeCache::BeginItem()
+{
+	LabelStart = StateLabels.Storage.Size();
+	ErrorStart = FScriptPosition::ErrorCounter;
+	WarnStart = FScriptPosition::WarnCounter;
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: Store
+//
+// Creates the record for a function that was just compiled. Functions
+// that printed something aren't cached so that the messages aren't lost,
+// and neither are functions with locals that need construction.
+//
+//==========================================================================
+
+void FScriptCodeCache::Store(unsigned index, const FString &name, PFunction *func, VMScriptFunction *sfunc)
+{
+	if (index >= Records.Size())
+	{
+		return;
+	}
+	if (FScriptPosition::ErrorCounter != ErrorStart || FScriptPosition::WarnCounter != WarnStart ||
+		sfunc->SpecialInits.Size() > 0)
+	{
+		return;
+	}
+
+	TArray<BYTE> data;
+	FCodeCacheWriter wr(data);
+
+	wr.String(name);
+	wr.Int(LabelStart);
+
+	// Record the state labels this function added. See FStateLabelStorage for the layout.
+	TArray<BYTE> labeldata;
+	FCodeCacheWriter lwr(labeldata);
+	auto &storage = StateLabels.Storage;
+	int numlabels = 0;
+	for (unsigned pos = LabelStart; pos < storage.Size(); numlabels++)
+	{
+		int numnames;
+		memcpy(&numnames, &storage[pos], sizeof(int));
+		lwr.Int(numnames);
+		if (numnames == 0)
+		{
+			FState *state;
+			memcpy(&state, &storage[pos + sizeof(int)], sizeof(state));
+			PClassActor *owner = FState::StaticFindStateOwner(state);
+			if (owner == nullptr) return;
+			lwr.String(owner->TypeName.GetChars());
+			lwr.Int(int(state - owner->OwnedStates));
+			pos += sizeof(int) + sizeof(state);
+		}
+		else
+		{
+			for (int i = 0; i < numnames; i++)
+			{
+				int labelname;
+				memcpy(&labelname, &storage[pos + sizeof(int) + i * sizeof(FName)], sizeof(int));
+				lwr.Int(labelname);
+			}
+			pos += sizeof(int) + numnames * sizeof(FName);
+		}
+	}
+	wr.Int(numlabels);
+	if (labeldata.Size() > 0) wr.Bytes(&labeldata[0], labeldata.Size());
+
+	wr.Int(sfunc->ExtraSpace);
+	wr.Int(sfunc->Unsafe);
+	wr.Int(sfunc->NumRegD);
+	wr.Int(sfunc->NumRegF);
+	wr.Int(sfunc->NumRegS);
+	wr.Int(sfunc->NumRegA);
+	wr.Int(sfunc->MaxParam);
+
+	if (func->SymbolName == NAME_None)
+	{
+		auto &rets = sfunc->Proto->ReturnTypes;
+		wr.Int(rets.Size());
+		for (auto type : rets)
+		{
+			int typeindex = CacheableTypeIndex(type);
+			if (typeindex < 0) return;
+			wr.Int(typeindex);
+		}
+	}
+	else
+	{
+		wr.Int(-1);
+	}
+
+	wr.String(sfunc->SourceFileName);
+	wr.Int(sfunc->CodeSize);
+	wr.Bytes(sfunc->Code, sfunc->CodeSize * sizeof(VMOP));
+	wr.Int(sfunc->LineInfoCount);
+	wr.Bytes(sfunc->LineInfo, sfunc->LineInfoCount * sizeof(FStatementInfo));
+	wr.Int(sfunc->NumKonstD);
+	wr.Bytes(sfunc->KonstD, sfunc->NumKonstD * sizeof(int));
+	wr.Int(sfunc->NumKonstF);
+	wr.Bytes(sfunc->KonstF, sfunc->NumKonstF * sizeof(double));
+	wr.Int(sfunc->NumKonstS);
+	for (int i = 0; i < sfunc->NumKonstS; i++)
+	{
+		wr.String(sfunc->KonstS[i]);
+	}
+	wr.Int(sfunc->NumKonstA);
+	for (int i = 0; i < sfunc->NumKonstA; i++)
+	{
+		FCodeCacheReloc reloc;
+		VM_ATAG tag = sfunc->KonstATags()[i];
+
+		if (!FindReloc(sfunc->KonstA[i].v, tag, reloc)) return;
+		wr.Bytes(&tag, 1);
+		wr.Bytes(&reloc.Kind, 1);
+		wr.String(reloc.Owner);
+		wr.String(reloc.Name);
+		wr.Int(reloc.Index);
+	}
+
+	if (!(Records[index] == data))
+	{
+		Records[index] = std::move(data);
+		Dirty = true;
+	}
+}
+
+//==========================================================================
+//
+// FScriptCodeCache :: End
+//
+// Only a successful compile gets written, and only if it compiled
+// something the file didn't already have.
+//
+//==========================================================================
+
+void FScriptCodeCache::End(bool success)
+{
+	if (success && Dirty)
+	{
+		WriteFile();
+	}
+	SourceLumps.Clear();
+	Records.Clear();
+	Relocs.Clear();
+	Valid = Dirty = RelocsBuilt = false;
+}
@@ -39,12 +39,15 @@
 #include "r_state.h"
 #include "textures/textures.h"
 #include "math/cmath.h"
+#include "vmprofile.h"
 
 // This must be a separate function because the VC compiler would otherwise allocate memory on the stack for every separate instance of the exception object that may get thrown.
 void ThrowAbortException(EVMAbortException reason, const char *moreinfo, ...);
 // intentionally implemented in a different source file tp prevent inlining.
 void ThrowVMException(VMException *x);
 
+EXTERN_CVAR(Bool, vm_jit)
+
 #define IMPLEMENT_VMEXEC
 
 #if !defined(COMPGOTO) && defined(__GNUC__)
@@ -53,10 +56,10 @@ void ThrowVMException(VMException *x);
 
 #if COMPGOTO
 #define OP(x)	x
-#define NEXTOP	do { pc++; unsigned op = pc->op; a = pc->a; goto *ops[op]; } while(0)
+#define NEXTOP	do { pc++; VM_COUNT_INSTR; unsigned op = pc->op; a = pc->a; goto *ops[op]; } while(0)
 #else
 #define OP(x)	case OP_##x
-#define NEXTOP	pc++; break
+#define NEXTOP	pc++; VM_COUNT_INSTR; break
 #endif
 
 #define luai_nummod(a,b)        ((a) - floor((a)/(b))*(b))
@@ -118,6 +121,8 @@ static const VM_UWORD ZapTable[16] =
 #endif
 #undef assert
 #include <assert.h>
+#define VM_PROFILE 0
+#define VM_COUNT_INSTR
 struct VMExec_Checked
 {
 #include "vmexec.h"
@@ -135,6 +140,17 @@ struct VMExec_Unchecked
 {
 #include "vmexec.h"
 };
+
+// The profiling interpreter counts every instruction and times every call.
+// It is only used while the profiler is active.
+#undef VM_PROFILE
+#undef VM_COUNT_INSTR
+#define VM_PROFILE 1
+#define VM_COUNT_INSTR	profile.Instr++
+struct VMExec_Profiled
+{
+#include "vmexec.h"
+};
 #if !WAS_NDEBUG
 #undef NDEBUG
 #endif
@@ -149,6 +165,11 @@ VMExec_Checked::Exec
 #endif
 ;
 
+int VMExecProfiled(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
+{
+	return VMExec_Profiled::Exec(stack, pc, ret, numret);
+}
+
 // Note: If the VM is being used in multiple threads, this should be declared as thread_local.
 // ZDoom doesn't need this at the moment so this is disabled.
 
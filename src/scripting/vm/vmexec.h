@@ -45,6 +45,22 @@ static int Exec(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
 	double fb, fc;
 	const double *fbp, *fcp;
 	int a, b, c;
+	const uint8_t *jitnative = NULL;
+
+#if VM_PROFILE
+	VMProfileScope profile(sfunc);
+#else
+	if (vm_jit && sfunc != NULL)
+	{
+		if (pc == sfunc->Code)
+		{
+			// Run whatever has been compiled to native code, then continue
+			// with the first instruction that wasn't.
+			pc += VMJitRun(sfunc, reg);
+		}
+		jitnative = sfunc->JitNative;
+	}
+#endif
 
 begin:
 	try
@@ -482,6 +498,12 @@ begin:
 		NEXTOP;
 	OP(JMP):
 		pc += JMPOFS(pc);
+		if (jitnative != NULL && jitnative[pc + 1 - sfunc->Code])
+		{
+			// Go back to native code at the jump target, which usually is
+			// the top of a loop or the end of an if/else.
+			pc = sfunc->Code + sfunc->JitFunc(reg.d, reg.f, int(pc + 1 - sfunc->Code)) - 1;
+		}
 		NEXTOP;
 	OP(IJMP):
 		ASSERTD(a);
@@ -643,6 +665,31 @@ begin:
 			pc += C;			// Skip RESULTs
 		}
 		NEXTOP;
+	OP(CALLN):
+		ASSERTKA(a);
+		assert(konstatag[a] == ATAG_OBJECT);
+		assert(C <= MAX_RETURNS);
+		{
+			VMNativeFunction *call = static_cast<VMNativeFunction *>(konsta[a].o);
+			VMReturn returns[MAX_RETURNS];
+			int numret;
+
+			assert(call->Native && call->DirectCall != NULL);
+			FillReturns(reg, f, returns, pc+1+B, C);
+			try
+			{
+				numret = call->DirectCall(reg, sfunc, pc+1, B, call->DefaultArgs, returns, C);
+			}
+			catch (CVMAbortException &err)
+			{
+				err.MaybePrintMessage();
+				err.stacktrace.AppendFormat("Called from %s\n", call->PrintableName.GetChars());
+				throw;
+			}
+			assert(numret == C && "Number of parameters returned differs from what was expected by the caller");
+			pc += B + C;		// Skip ARGs and RESULTs
+		}
+		NEXTOP;
 	OP(TAIL_K):
 		ASSERTKA(a);
 		assert(konstatag[a] == ATAG_OBJECT);
@@ -731,6 +778,11 @@ begin:
 		assert(0);
 		NEXTOP;
 
+	OP(ARG):
+		// Likewise, this is only read by the CALLN in front of it.
+		assert(0);
+		NEXTOP;
+
 	OP(TRY):
 		assert(try_depth < MAX_TRY_DEPTH);
 		if (try_depth >= MAX_TRY_DEPTH)
@@ -35,6 +35,7 @@
 #include <new>
 #include "dobject.h"
 #include "v_text.h"
+#include "vmprofile.h"
 
 IMPLEMENT_CLASS(VMException, false, false)
 IMPLEMENT_CLASS(VMFunction, true, true)
@@ -69,6 +70,10 @@ VMScriptFunction::VMScriptFunction(FName name)
 	NumKonstA = 0;
 	MaxParam = 0;
 	NumArgs = 0;
+	JitFunc = nullptr;
+	JitNative = nullptr;
+	JitCalls = 0;
+	ProfileData = nullptr;
 }
 
 VMScriptFunction::~VMScriptFunction()
@@ -84,6 +89,14 @@ VMScriptFunction::~VMScriptFunction()
 		}
 		M_Free(Code);
 	}
+	if (JitNative != nullptr)
+	{
+		delete[] JitNative;
+	}
+	if (ProfileData != nullptr)
+	{
+		VMProfileRelease(this);
+	}
 }
 
 void VMScriptFunction::Alloc(int numops, int numkonstd, int numkonstf, int numkonsts, int numkonsta, int numlinenumbers)
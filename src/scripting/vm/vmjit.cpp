@@ -0,0 +1,637 @@
+/*
+** vmjit.cpp
+** Native x86-64 code generation for VM script functions
+**
+**---------------------------------------------------------------------------
+** Copyright 2016 The ZDoom Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The JIT only translates the integer and floating point register
+** instructions. Every other instruction is compiled into an exit that
+** returns its index, and the interpreter resumes the function from there
+** with the same frame, so anything the JIT does not understand simply
+** runs at interpreter speed. The native code can be entered at any
+** instruction through a jump table; the interpreter goes back to it when
+** it executes a JMP to a compiled instruction, so loops whose bodies
+** contain calls or memory access still run their arithmetic and branches
+** natively. The registers stay in the VM frame; the generated code only
+** saves the dispatch and operand decoding.
+**
+*/
+
+#include <string.h>
+#include "dobject.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "templates.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VM_JIT_X64 1
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
+CVAR(Bool, vm_jit, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+// A function must be called this many times before it gets compiled.
+// Most script functions run only a handful of times, so compiling them
+// would cost more than it saves.
+enum { JIT_CALL_THRESHOLD = 16 };
+
+static int JitCompiled, JitRejected;
+static size_t JitCodeSize;
+
+#ifdef VM_JIT_X64
+
+//==========================================================================
+//
+// Executable memory
+//
+// Compiled code is never freed individually. Script functions live until
+// the VM is shut down, so a simple bump allocator is all that's needed.
+// Pages are never writable and executable at the same time: they are
+// mapped read/write and each function's pages are switched to
+// read/execute once its code has been copied in. A page shared with the
+// previous function is briefly made writable again, which is safe because
+// native code never calls out, so none of it can be running while the
+// JIT is.
+//
+//==========================================================================
+
+static uint8_t *JitBlock;
+static size_t JitBlockLeft;
+static size_t JitPageSize;
+
+static size_t JitGetPageSize()
+{
+	if (JitPageSize == 0)
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		JitPageSize = info.dwPageSize;
+#else
+		JitPageSize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+	return JitPageSize;
+}
+
+static bool JitProtect(uint8_t *mem, size_t size, bool exec)
+{
+	size_t pagesize = JitGetPageSize();
+	uintptr_t start = uintptr_t(mem) & ~(pagesize - 1);
+	uintptr_t end = (uintptr_t(mem) + size + pagesize - 1) & ~(pagesize - 1);
+#ifdef _WIN32
+	DWORD oldprotect;
+	if (!VirtualProtect((void *)start, end - start, exec ? PAGE_EXECUTE_READ : PAGE_READWRITE, &oldprotect))
+	{
+		return false;
+	}
+	if (exec)
+	{
+		FlushInstructionCache(GetCurrentProcess(), mem, size);
+	}
+	return true;
+#else
+	return mprotect((void *)start, end - start, exec ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static uint8_t *JitAllocCode(size_t size)
+{
+	size = (size + 15) & ~15;
+	if (size > JitBlockLeft)
+	{
+		size_t pagesize = JitGetPageSize();
+		size_t blocksize = (MAX<size_t>(size, 65536) + pagesize - 1) & ~(pagesize - 1);
+#ifdef _WIN32
+		void *mem = VirtualAlloc(nullptr, blocksize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+		void *mem = mmap(nullptr, blocksize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) mem = nullptr;
+#endif
+		if (mem == nullptr)
+		{
+			return nullptr;
+		}
+		JitBlock = (uint8_t *)mem;
+		JitBlockLeft = blocksize;
+	}
+	uint8_t *p = JitBlock;
+	JitBlock += size;
+	JitBlockLeft -= size;
+	return p;
+}
+
+//==========================================================================
+//
+// FJitEmitter
+//
+// The generated function receives the frame's integer and float register
+// pointers and the index of the instruction to start at. The pointers are
+// moved into r8 and r9, which are volatile in both the SysV and the Win64
+// calling conventions, so nothing needs to be saved. The start index is
+// looked up in a table of code offsets that follows the code.
+// eax, ecx, edx and xmm0-xmm2 are used as scratch.
+//
+//==========================================================================
+
+enum
+{
+	RAX = 0, RCX = 1, RDX = 2,
+	BASE_D = 0,		// r8
+	BASE_F = 1,		// r9
+
+	CC_B = 2, CC_AE = 3, CC_E = 4, CC_NE = 5, CC_BE = 6, CC_A = 7,
+	CC_L = 12, CC_GE = 13, CC_LE = 14, CC_G = 15,
+};
+
+class FJitEmitter
+{
+public:
+	FJitEmitter(VMScriptFunction *func) : Func(func) {}
+	bool Compile();
+	VMJitFunc Finish();
+
+private:
+	struct FFixup
+	{
+		unsigned Pos;
+		int Target;
+	};
+
+	VMScriptFunction *Func;
+	TArray<uint8_t> Code;
+	TArray<unsigned> Labels;
+	TArray<FFixup> Fixups;
+	TArray<uint8_t> Native;
+	unsigned TableRef;
+
+	void Byte(int b) { Code.Push(uint8_t(b)); }
+	void Dword(uint32_t v) { for (int i = 0; i < 4; i++) Byte(v >> (i * 8)); }
+	void Qword(uint64_t v) { Dword(uint32_t(v)); Dword(uint32_t(v >> 32)); }
+
+	void MemOp(int reg, int base, int disp)
+	{
+		Byte(0x80 | (reg << 3) | base);	// [r8/r9 + disp32]
+		Dword(disp);
+	}
+	void LoadD(int r, int regnum) { Byte(0x41); Byte(0x8B); MemOp(r, BASE_D, regnum * 4); }
+	void StoreD(int regnum, int r) { Byte(0x41); Byte(0x89); MemOp(r, BASE_D, regnum * 4); }
+	void LoadImm(int r, int v) { Byte(0xB8 + r); Dword(v); }
+	void LoadF(int x, int regnum) { Byte(0xF2); Byte(0x41); Byte(0x0F); Byte(0x10); MemOp(x, BASE_F, regnum * 8); }
+	void StoreF(int regnum, int x) { Byte(0xF2); Byte(0x41); Byte(0x0F); Byte(0x11); MemOp(x, BASE_F, regnum * 8); }
+	void LoadFImm(int x, double v)
+	{
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		Byte(0x48); Byte(0xB8); Qword(bits);						// mov rax, imm64
+		Byte(0x66); Byte(0x48); Byte(0x0F); Byte(0x6E); Byte(0xC0 | (x << 3));	// movq xmm, rax
+	}
+	void IntOperand(int r, bool konst, int index) { if (konst) LoadImm(r, Func->KonstD[index]); else LoadD(r, index); }
+	void FloatOperand(int x, bool konst, int index) { if (konst) LoadFImm(x, Func->KonstF[index]); else LoadF(x, index); }
+
+	void IntOp(int opcode) { Byte(opcode); Byte(0xC8); }			// op eax, ecx
+	void FloatOp(int opcode) { Byte(0xF2); Byte(0x0F); Byte(opcode); Byte(0xC1); }	// op xmm0, xmm1
+
+	void Exit(int index) { LoadImm(RAX, index); Byte(0xC3); }
+	void Jump(int target) { Byte(0xE9); AddFixup(target); }
+	void Branch(int cc, int target) { Byte(0x0F); Byte(0x80 + cc); AddFixup(target); }
+	void AddFixup(int target)
+	{
+		Fixups.Push({ Code.Size(), target });
+		Dword(0);
+	}
+
+	bool CompileOp(int i);
+	bool CompareJump(int i, int cc);
+	bool CompareJumpF(int i, bool equal, int cc);
+};
+
+//==========================================================================
+//
+// FJitEmitter :: Compile
+//
+//==========================================================================
+
+bool FJitEmitter::Compile()
+{
+	const VMOP *code = Func->Code;
+	int numops = Func->CodeSize;
+
+	// Exception handling keeps state in the interpreter's locals, so don't
+	// let native code jump around inside a protected region.
+	for (int i = 0; i < numops; i++)
+	{
+		int op = code[i].op;
+		if (op == OP_TRY || op == OP_UNTRY || op == OP_THROW || op == OP_CATCH)
+		{
+			return false;
+		}
+	}
+
+	// Move the register pointers into place and jump to the start instruction.
+#ifdef _WIN32
+	Byte(0x44); Byte(0x89); Byte(0xC0);		// mov eax, r8d
+	Byte(0x49); Byte(0x89); Byte(0xC8);		// mov r8, rcx
+	Byte(0x49); Byte(0x89); Byte(0xD1);		// mov r9, rdx
+#else
+	Byte(0x89); Byte(0xD0);					// mov eax, edx
+	Byte(0x49); Byte(0x89); Byte(0xF8);		// mov r8, rdi
+	Byte(0x49); Byte(0x89); Byte(0xF1);		// mov r9, rsi
+#endif
+	Byte(0x48); Byte(0x8D); Byte(0x0D);		// lea rcx, [table]
+	TableRef = Code.Size();
+	Dword(0);
+	Byte(0x48); Byte(0x63); Byte(0x04); Byte(0x81);	// movsxd rax, [rcx + rax*4]
+	Byte(0x48); Byte(0x01); Byte(0xC8);		// add rax, rcx
+	Byte(0xFF); Byte(0xE0);					// jmp rax
+
+	int numnative = 0;
+	Labels.Resize(numops);
+	Native.Resize(numops);
+	for (int i = 0; i < numops; i++)
+	{
+		Labels[i] = Code.Size();
+		Native[i] = CompileOp(i);
+		if (Native[i])
+		{
+			numnative++;
+		}
+		else
+		{
+			// Throw away any partially emitted operand loads.
+			Code.Resize(Labels[i]);
+			Exit(i);
+		}
+	}
+	if (numnative == 0)
+	{
+		return false;	// Nothing to gain from compiling this.
+	}
+
+	for (auto &fix : Fixups)
+	{
+		if (fix.Target < 0 || fix.Target >= numops)
+		{
+			return false;
+		}
+		int32_t rel = int32_t(Labels[fix.Target] - (fix.Pos + 4));
+		memcpy(&Code[fix.Pos], &rel, 4);
+	}
+
+	// The entry table holds each instruction's offset from the table.
+	while (Code.Size() & 3) Byte(0xCC);
+	unsigned table = Code.Size();
+	int32_t rel = int32_t(table - (TableRef + 4));
+	memcpy(&Code[TableRef], &rel, 4);
+	for (int i = 0; i < numops; i++)
+	{
+		Dword(uint32_t(Labels[i] - table));
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FJitEmitter :: CompareJump
+//
+// Compare instructions are always followed by a JMP which is taken when
+// the comparison's result matches the CMP_CHECK bit. eax and ecx must
+// hold the operands.
+//
+//==========================================================================
+
+bool FJitEmitter::CompareJump(int i, int cc)
+{
+	const VMOP *pc = Func->Code + i;
+	if (i + 1 >= Func->CodeSize || pc[1].op != OP_JMP)
+	{
+		return false;
+	}
+	IntOp(0x39);	// cmp eax, ecx
+	Branch((pc->a & CMP_CHECK) ? cc : cc ^ 1, i + 2 + pc[1].i24);
+	Jump(i + 2);
+	return true;
+}
+
+//==========================================================================
+//
+// FJitEmitter :: CompareJumpF
+//
+// Same for floating point with the operands in xmm0 and xmm1. Ordering
+// tests compare xmm1 to xmm0 so that unordered operands come out false
+// like they do in C++.
+//
+//==========================================================================
+
+bool FJitEmitter::CompareJumpF(int i, bool equal, int cc)
+{
+	const VMOP *pc = Func->Code + i;
+	if (i + 1 >= Func->CodeSize || pc[1].op != OP_JMP || (pc->a & CMP_APPROX))
+	{
+		return false;
+	}
+	if (equal)
+	{
+		Byte(0x66); Byte(0x0F); Byte(0x2E); Byte(0xC1);	// ucomisd xmm0, xmm1
+		Byte(0x0F); Byte(0x9B); Byte(0xC0);				// setnp al
+		Byte(0x0F); Byte(0x94); Byte(0xC1);				// sete cl
+		Byte(0x20); Byte(0xC8);							// and al, cl
+		Byte(0x84); Byte(0xC0);							// test al, al
+		cc = CC_NE;
+	}
+	else
+	{
+		Byte(0x66); Byte(0x0F); Byte(0x2E); Byte(0xC8);	// ucomisd xmm1, xmm0
+	}
+	Branch((pc->a & CMP_CHECK) ? cc : cc ^ 1, i + 2 + pc[1].i24);
+	Jump(i + 2);
+	return true;
+}
+
+//==========================================================================
+//
+// FJitEmitter :: CompileOp
+//
+// Returns false for anything that must be left to the interpreter.
+//
+//==========================================================================
+
+bool FJitEmitter::CompileOp(int i)
+{
+	const VMOP *pc = Func->Code + i;
+	int a = pc->a, b = pc->b, c = pc->c;
+
+	switch (pc->op)
+	{
+	case OP_NOP:
+		return true;
+
+	case OP_LI:		LoadImm(RAX, pc->i16); StoreD(a, RAX); return true;
+	case OP_LK:		LoadImm(RAX, Func->KonstD[pc->i16u]); StoreD(a, RAX); return true;
+	case OP_LKF:	LoadFImm(0, Func->KonstF[pc->i16u]); StoreF(a, 0); return true;
+	case OP_MOVE:	LoadD(RAX, b); StoreD(a, RAX); return true;
+	case OP_MOVEF:	LoadF(0, b); StoreF(a, 0); return true;
+
+	case OP_CAST:
+		if (c == CAST_I2F)
+		{
+			LoadD(RAX, b);
+			Byte(0xF2); Byte(0x0F); Byte(0x2A); Byte(0xC0);	// cvtsi2sd xmm0, eax
+			StoreF(a, 0);
+			return true;
+		}
+		else if (c == CAST_F2I)
+		{
+			LoadF(0, b);
+			Byte(0xF2); Byte(0x0F); Byte(0x2C); Byte(0xC0);	// cvttsd2si eax, xmm0
+			StoreD(a, RAX);
+			return true;
+		}
+		return false;
+
+	case OP_JMP:
+		Jump(i + 1 + pc->i24);
+		return true;
+
+	case OP_TEST:
+	case OP_TESTN:
+		LoadD(RAX, a);
+		if (pc->op == OP_TESTN) { Byte(0xF7); Byte(0xD8); }	// neg eax
+		Byte(0x3D); Dword(pc->i16u);						// cmp eax, imm32
+		Branch(CC_NE, i + 2);
+		return true;
+
+	// Integer math
+	case OP_ADD_RR:	case OP_ADD_RK:
+	case OP_SUB_RR:	case OP_SUB_RK:	case OP_SUB_KR:
+	case OP_MUL_RR:	case OP_MUL_RK:
+	case OP_AND_RR:	case OP_AND_RK:
+	case OP_OR_RR:	case OP_OR_RK:
+	case OP_XOR_RR:	case OP_XOR_RK:
+	case OP_MIN_RR:	case OP_MIN_RK:
+	case OP_MAX_RR:	case OP_MAX_RK:
+	case OP_SLL_RR:	case OP_SLL_KR:
+	case OP_SRL_RR:	case OP_SRL_KR:
+	case OP_SRA_RR:	case OP_SRA_KR:
+	{
+		int op = pc->op;
+		bool kb = op == OP_SUB_KR || op == OP_SLL_KR || op == OP_SRL_KR || op == OP_SRA_KR;
+		bool kc = op == OP_ADD_RK || op == OP_SUB_RK || op == OP_MUL_RK || op == OP_AND_RK ||
+			op == OP_OR_RK || op == OP_XOR_RK || op == OP_MIN_RK || op == OP_MAX_RK;
+
+		IntOperand(RAX, kb, b);
+		IntOperand(RCX, kc, c);
+		switch (op)
+		{
+		case OP_ADD_RR: case OP_ADD_RK:		IntOp(0x01); break;
+		case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:	IntOp(0x29); break;
+		case OP_AND_RR: case OP_AND_RK:		IntOp(0x21); break;
+		case OP_OR_RR: case OP_OR_RK:		IntOp(0x09); break;
+		case OP_XOR_RR: case OP_XOR_RK:		IntOp(0x31); break;
+		case OP_MUL_RR: case OP_MUL_RK:		Byte(0x0F); Byte(0xAF); Byte(0xC1); break;	// imul eax, ecx
+		case OP_MIN_RR: case OP_MIN_RK:		IntOp(0x39); Byte(0x0F); Byte(0x4F); Byte(0xC1); break;	// cmovg eax, ecx
+		case OP_MAX_RR: case OP_MAX_RK:		IntOp(0x39); Byte(0x0F); Byte(0x4C); Byte(0xC1); break;	// cmovl eax, ecx
+		case OP_SLL_RR: case OP_SLL_KR:		Byte(0xD3); Byte(0xE0); break;	// shl eax, cl
+		case OP_SRL_RR: case OP_SRL_KR:		Byte(0xD3); Byte(0xE8); break;	// shr eax, cl
+		case OP_SRA_RR: case OP_SRA_KR:		Byte(0xD3); Byte(0xF8); break;	// sar eax, cl
+		}
+		StoreD(a, RAX);
+		return true;
+	}
+
+	case OP_ADDI:
+		LoadD(RAX, b);
+		Byte(0x05); Dword(pc->cs);		// add eax, imm32
+		StoreD(a, RAX);
+		return true;
+
+	case OP_SLL_RI:
+	case OP_SRL_RI:
+	case OP_SRA_RI:
+		LoadD(RAX, b);
+		Byte(0xC1); Byte(pc->op == OP_SLL_RI ? 0xE0 : pc->op == OP_SRL_RI ? 0xE8 : 0xF8); Byte(c & 31);
+		StoreD(a, RAX);
+		return true;
+
+	case OP_NEG:	LoadD(RAX, b); Byte(0xF7); Byte(0xD8); StoreD(a, RAX); return true;
+	case OP_NOT:	LoadD(RAX, b); Byte(0xF7); Byte(0xD0); StoreD(a, RAX); return true;
+	case OP_ABS:
+		LoadD(RAX, b);
+		Byte(0x89); Byte(0xC1);					// mov ecx, eax
+		Byte(0xF7); Byte(0xD8);					// neg eax
+		Byte(0x0F); Byte(0x48); Byte(0xC1);		// cmovs eax, ecx
+		StoreD(a, RAX);
+		return true;
+
+	// Integer comparisons
+	case OP_EQ_R:	LoadD(RAX, b); LoadD(RCX, c); return CompareJump(i, CC_E);
+	case OP_EQ_K:	LoadD(RAX, b); IntOperand(RCX, true, c); return CompareJump(i, CC_E);
+	case OP_LT_RR:	LoadD(RAX, b); LoadD(RCX, c); return CompareJump(i, CC_L);
+	case OP_LT_RK:	LoadD(RAX, b); IntOperand(RCX, true, c); return CompareJump(i, CC_L);
+	case OP_LT_KR:	IntOperand(RAX, true, b); LoadD(RCX, c); return CompareJump(i, CC_L);
+	case OP_LE_RR:	LoadD(RAX, b); LoadD(RCX, c); return CompareJump(i, CC_LE);
+	case OP_LE_RK:	LoadD(RAX, b); IntOperand(RCX, true, c); return CompareJump(i, CC_LE);
+	case OP_LE_KR:	IntOperand(RAX, true, b); LoadD(RCX, c); return CompareJump(i, CC_LE);
+	case OP_LTU_RR:	LoadD(RAX, b); LoadD(RCX, c); return CompareJump(i, CC_B);
+	case OP_LTU_RK:	LoadD(RAX, b); IntOperand(RCX, true, c); return CompareJump(i, CC_B);
+	case OP_LTU_KR:	IntOperand(RAX, true, b); LoadD(RCX, c); return CompareJump(i, CC_B);
+	case OP_LEU_RR:	LoadD(RAX, b); LoadD(RCX, c); return CompareJump(i, CC_BE);
+	case OP_LEU_RK:	LoadD(RAX, b); IntOperand(RCX, true, c); return CompareJump(i, CC_BE);
+	case OP_LEU_KR:	IntOperand(RAX, true, b); LoadD(RCX, c); return CompareJump(i, CC_BE);
+
+	// Floating point math
+	case OP_ADDF_RR:	case OP_ADDF_RK:
+	case OP_SUBF_RR:	case OP_SUBF_RK:	case OP_SUBF_KR:
+	case OP_MULF_RR:	case OP_MULF_RK:
+	case OP_DIVF_RR:	case OP_DIVF_RK:	case OP_DIVF_KR:
+	{
+		int op = pc->op;
+		bool kb = op == OP_SUBF_KR || op == OP_DIVF_KR;
+		bool kc = op == OP_ADDF_RK || op == OP_SUBF_RK || op == OP_MULF_RK || op == OP_DIVF_RK;
+
+		FloatOperand(0, kb, b);
+		FloatOperand(1, kc, c);
+		switch (op)
+		{
+		case OP_ADDF_RR: case OP_ADDF_RK:	FloatOp(0x58); break;
+		case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:	FloatOp(0x5C); break;
+		case OP_MULF_RR: case OP_MULF_RK:	FloatOp(0x59); break;
+		default:
+			// Division by zero must throw, so let the interpreter redo this instruction.
+			Byte(0x66); Byte(0x0F); Byte(0x57); Byte(0xD2);	// xorpd xmm2, xmm2
+			Byte(0x66); Byte(0x0F); Byte(0x2E); Byte(0xCA);	// ucomisd xmm1, xmm2
+			Byte(0x7A); Byte(0x08);							// jp +8
+			Byte(0x75); Byte(0x06);							// jne +6
+			Exit(i);
+			FloatOp(0x5E);
+			break;
+		}
+		StoreF(a, 0);
+		return true;
+	}
+
+	// Floating point comparisons
+	case OP_EQF_R:	LoadF(0, b); LoadF(1, c); return CompareJumpF(i, true, CC_NE);
+	case OP_EQF_K:	LoadF(0, b); FloatOperand(1, true, c); return CompareJumpF(i, true, CC_NE);
+	case OP_LTF_RR:	LoadF(0, b); LoadF(1, c); return CompareJumpF(i, false, CC_A);
+	case OP_LTF_RK:	LoadF(0, b); FloatOperand(1, true, c); return CompareJumpF(i, false, CC_A);
+	case OP_LTF_KR:	FloatOperand(0, true, b); LoadF(1, c); return CompareJumpF(i, false, CC_A);
+	case OP_LEF_RR:	LoadF(0, b); LoadF(1, c); return CompareJumpF(i, false, CC_AE);
+	case OP_LEF_RK:	LoadF(0, b); FloatOperand(1, true, c); return CompareJumpF(i, false, CC_AE);
+	case OP_LEF_KR:	FloatOperand(0, true, b); LoadF(1, c); return CompareJumpF(i, false, CC_AE);
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// FJitEmitter :: Finish
+//
+//==========================================================================
+
+VMJitFunc FJitEmitter::Finish()
+{
+	uint8_t *mem = JitAllocCode(Code.Size());
+	if (mem == nullptr || !JitProtect(mem, Code.Size(), false))
+	{
+		return nullptr;
+	}
+	memcpy(mem, &Code[0], Code.Size());
+	if (!JitProtect(mem, Code.Size(), true))
+	{
+		return nullptr;
+	}
+	JitCodeSize += Code.Size();
+
+	Func->JitNative = new uint8_t[Native.Size()];
+	memcpy(Func->JitNative, &Native[0], Native.Size());
+	return (VMJitFunc)mem;
+}
+
+#endif
+
+//==========================================================================
+//
+// VMJitRun
+//
+// Called by the interpreter when it enters a script function. Returns the
+// index of the instruction where the interpreter has to pick up, which is
+// 0 if the function has no native code.
+//
+//==========================================================================
+
+int VMJitRun(VMScriptFunction *func, const VMRegisters &reg)
+{
+	if (func->JitFunc == nullptr)
+	{
+		if (func->JitCalls < 0 || ++func->JitCalls < JIT_CALL_THRESHOLD)
+		{
+			return 0;
+		}
+#ifdef VM_JIT_X64
+		FJitEmitter jit(func);
+		if (jit.Compile())
+		{
+			func->JitFunc = jit.Finish();
+		}
+#endif
+		if (func->JitFunc == nullptr)
+		{
+			func->JitCalls = -1;
+			JitRejected++;
+			return 0;
+		}
+		JitCompiled++;
+	}
+	return func->JitFunc(reg.d, reg.f, 0);
+}
+
+//==========================================================================
+//
+// CCMD vmjitstats
+//
+//==========================================================================
+
+CCMD(vmjitstats)
+{
+#ifdef VM_JIT_X64
+	Printf("JIT %s: %d functions compiled, %d rejected, %zu bytes of code\n",
+		*vm_jit ? "enabled" : "disabled", JitCompiled, JitRejected, JitCodeSize);
+#else
+	Printf("The JIT is not available on this platform\n");
+#endif
+}
@@ -96,10 +96,12 @@ xx(PARAM,	param,	__BCP,		NOP,	0, 0),		// push parameter encoded in BC for functi
 xx(PARAMI,	parami,	I24,		NOP,	0, 0),		// push immediate, signed integer for function call
 xx(CALL,	call,	RPI8I8,		NOP,	0, 0),	// Call function pkA with parameter count B and expected result count C
 xx(CALL_K,	call,	KPI8I8,		CALL,	1, REGT_POINTER),
+xx(CALLN,	calln,	KPI8I8,		NOP,	0, 0),	// Call native function kA directly with the B ARGs that follow and expected result count C
 xx(VTBL,	vtbl,	RPRPI8,		NOP,	0, 0),	// dereferences a virtual method table.
 xx(TAIL,	tail,	RPI8,		NOP,	0, 0),		// Call+Ret in a single instruction
 xx(TAIL_K,	tail,	KPI8,		TAIL,	1, REGT_POINTER),
 xx(RESULT,	result,	__BCP,		NOP,	0, 0),		// Result should go in register encoded in BC (in caller, after CALL)
+xx(ARG,		arg,	__BCP,		NOP,	0, 0),		// Argument in register encoded in BC (in caller, after CALLN)
 xx(RET,		ret,	I8BCP,		NOP,	0, 0),		// Copy value from register encoded in BC to return value A, possibly returning
 xx(RETI,	reti,	I8I16,		NOP,	0, 0),		// Copy immediate from BC to return value A, possibly returning
 xx(TRY,		try,	I24,		NOP,	0, 0),		// When an exception is thrown, start searching for a handler at pc + ABC
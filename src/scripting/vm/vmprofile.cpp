@@ -0,0 +1,327 @@
+/*
+** vmprofile.cpp
+** Per-function profiling for the script VM
+**
+**---------------------------------------------------------------------------
+** Copyright 2016 The ZDoom Team
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The profiler works by switching the VM to a separate instance of the
+** interpreter that maintains the counters, so there is no cost at all
+** while it is turned off.
+**
+*/
+
+#include <stdio.h>
+#include "dobject.h"
+#include "c_dispatch.h"
+#include "v_text.h"
+#include "vmprofile.h"
+
+int VMExecProfiled(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret);
+
+VMProfileScope *VMProfileScope::Current;
+
+static TArray<VMProfileInfo *> ProfiledFunctions;
+static int (*UnprofiledExec)(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret);
+
+//==========================================================================
+//
+// VMProfileAlloc
+//
+//==========================================================================
+
+VMProfileInfo *VMProfileAlloc(VMScriptFunction *func)
+{
+	if (func->ProfileData == nullptr)
+	{
+		func->ProfileData = new VMProfileInfo;
+		func->ProfileData->Func = func;
+		func->ProfileData->Reset();
+		ProfiledFunctions.Push(func->ProfileData);
+	}
+	return func->ProfileData;
+}
+
+//==========================================================================
+//
+// VMProfileRelease
+//
+// Called when a function that has been profiled is destroyed.
+//
+//==========================================================================
+
+void VMProfileRelease(VMScriptFunction *func)
+{
+	unsigned index = ProfiledFunctions.Find(func->ProfileData);
+	if (index < ProfiledFunctions.Size())
+	{
+		ProfiledFunctions.Delete(index);
+	}
+	delete func->ProfileData;
+	func->ProfileData = nullptr;
+}
+
+//==========================================================================
+//
+// VMProfiling
+//
+//==========================================================================
+
+bool VMProfiling()
+{
+	return UnprofiledExec != nullptr;
+}
+
+static void StartProfiling()
+{
+	if (UnprofiledExec == nullptr)
+	{
+		UnprofiledExec = VMExec;
+		VMExec = VMExecProfiled;
+	}
+}
+
+static void StopProfiling()
+{
+	if (UnprofiledExec != nullptr)
+	{
+		VMExec = UnprofiledExec;
+		UnprofiledExec = nullptr;
+	}
+}
+
+//==========================================================================
+//
+// Sorting
+//
+//==========================================================================
+
+static int sort_by_calls(const void *a_, const void *b_)
+{
+	auto a = *(const VMProfileInfo * const *)a_;
+	auto b = *(const VMProfileInfo * const *)b_;
+	return a->NumCalls < b->NumCalls ? 1 : a->NumCalls > b->NumCalls ? -1 : 0;
+}
+
+static int sort_by_total(const void *a_, const void *b_)
+{
+	auto a = *(VMProfileInfo * const *)a_;
+	auto b = *(VMProfileInfo * const *)b_;
+	double at = a->Inclusive.TimeMS(), bt = b->Inclusive.TimeMS();
+	return at < bt ? 1 : at > bt ? -1 : 0;
+}
+
+static int sort_by_self(const void *a_, const void *b_)
+{
+	auto a = *(VMProfileInfo * const *)a_;
+	auto b = *(VMProfileInfo * const *)b_;
+	double at = a->Exclusive.TimeMS(), bt = b->Exclusive.TimeMS();
+	return at < bt ? 1 : at > bt ? -1 : 0;
+}
+
+static int sort_by_instr(const void *a_, const void *b_)
+{
+	auto a = *(const VMProfileInfo * const *)a_;
+	auto b = *(const VMProfileInfo * const *)b_;
+	return a->NumInstr < b->NumInstr ? 1 : a->NumInstr > b->NumInstr ? -1 : 0;
+}
+
+//==========================================================================
+//
+// ShowProfileData
+//
+//==========================================================================
+
+static void ShowProfileData(TArray<VMProfileInfo *> &profiles, long ilimit)
+{
+	unsigned int limit;
+
+	if (ilimit > 0)
+	{
+		Printf(TEXTCOLOR_ORANGE "Top %ld functions:\n", ilimit);
+		limit = (unsigned int)ilimit;
+	}
+	else
+	{
+		Printf(TEXTCOLOR_ORANGE "All functions:\n");
+		limit = UINT_MAX;
+	}
+
+	Printf(TEXTCOLOR_YELLOW "Function                                   Calls   Total ms    Self ms       Instr  Avg\n");
+	Printf(TEXTCOLOR_YELLOW "---------------------------------------- -------- ---------- ---------- ----------- ----\n");
+	for (unsigned int i = 0, shown = 0; shown < limit && i < profiles.Size(); ++i)
+	{
+		VMProfileInfo *prof = profiles[i];
+		if (prof->NumCalls == 0)
+		{ // Don't list ones that haven't run.
+			continue;
+		}
+		Printf("%-40.40s %8llu %10.3f %10.3f %11llu %4llu\n",
+			prof->Func->PrintableName.GetChars(),
+			prof->NumCalls,
+			prof->Inclusive.TimeMS(),
+			prof->Exclusive.TimeMS(),
+			prof->NumInstr,
+			prof->NumInstr / prof->NumCalls);
+		shown++;
+	}
+}
+
+//==========================================================================
+//
+// ExportProfileData
+//
+// Writes everything as comma separated values for use in a spreadsheet.
+//
+//==========================================================================
+
+static void ExportProfileData(TArray<VMProfileInfo *> &profiles, const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == nullptr)
+	{
+		Printf("Could not open %s for writing\n", filename);
+		return;
+	}
+	fprintf(f, "Function,Source,Calls,Total ms,Self ms,Instructions\n");
+	for (auto prof : profiles)
+	{
+		if (prof->NumCalls != 0)
+		{
+			fprintf(f, "\"%s\",\"%s\",%llu,%f,%f,%llu\n",
+				prof->Func->PrintableName.GetChars(),
+				prof->Func->SourceFileName.GetChars(),
+				prof->NumCalls,
+				prof->Inclusive.TimeMS(),
+				prof->Exclusive.TimeMS(),
+				prof->NumInstr);
+		}
+	}
+	fclose(f);
+	Printf("Profile written to %s\n", filename);
+}
+
+//==========================================================================
+//
+// CCMD vmprofile
+//
+//==========================================================================
+
+CCMD(vmprofile)
+{
+	static int (*sort_funcs[])(const void*, const void *) =
+	{
+		sort_by_total,
+		sort_by_self,
+		sort_by_calls,
+		sort_by_instr,
+	};
+	static const char *sort_names[] = { "total", "self", "calls", "instr" };
+
+	long limit = 10;
+	int (*sorter)(const void *, const void *) = sort_by_self;
+
+	if (argv.argc() > 1)
+	{
+		if (stricmp(argv[1], "on") == 0 || stricmp(argv[1], "start") == 0)
+		{
+			StartProfiling();
+			return;
+		}
+		if (stricmp(argv[1], "off") == 0 || stricmp(argv[1], "stop") == 0)
+		{
+			StopProfiling();
+			return;
+		}
+		// `vmprofile clear` will zero all profiling information collected so far.
+		if (stricmp(argv[1], "clear") == 0)
+		{
+			for (auto prof : ProfiledFunctions)
+			{
+				prof->Reset();
+			}
+			return;
+		}
+		if (stricmp(argv[1], "export") == 0)
+		{
+			if (argv.argc() < 3)
+			{
+				Printf("Usage: vmprofile export <filename>\n");
+				return;
+			}
+			TArray<VMProfileInfo *> profiles = ProfiledFunctions;
+			if (profiles.Size() > 0)
+			{
+				qsort(&profiles[0], profiles.Size(), sizeof(profiles[0]), sorter);
+			}
+			ExportProfileData(profiles, argv[2]);
+			return;
+		}
+		for (int i = 1; i < argv.argc(); ++i)
+		{
+			// If it's a number, set the display limit.
+			char *endptr;
+			long num = strtol(argv[i], &endptr, 0);
+			if (endptr != argv[i])
+			{
+				limit = num;
+				continue;
+			}
+			unsigned int j;
+			for (j = 0; j < countof(sort_names); ++j)
+			{
+				if (stricmp(argv[i], sort_names[j]) == 0)
+				{
+					sorter = sort_funcs[j];
+					break;
+				}
+			}
+			if (j == countof(sort_names))
+			{
+				Printf("Unknown option '%s'\n", argv[i]);
+				Printf("vmprofile on|off : Start or stop collecting profiling information\n");
+				Printf("vmprofile clear : Reset profiling information\n");
+				Printf("vmprofile export <filename> : Write profiling information to a file\n");
+				Printf("vmprofile [total|self|calls|instr] [<limit>]\n");
+				return;
+			}
+		}
+	}
+
+	if (!VMProfiling() && ProfiledFunctions.Size() == 0)
+	{
+		Printf("No profiling information. Use 'vmprofile on' to start collecting it.\n");
+		return;
+	}
+	TArray<VMProfileInfo *> profiles = ProfiledFunctions;
+	if (profiles.Size() > 0)
+	{
+		qsort(&profiles[0], profiles.Size(), sizeof(profiles[0]), sorter);
+		ShowProfileData(profiles, limit);
+	}
+}
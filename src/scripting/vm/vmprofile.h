@@ -0,0 +1,87 @@
+#ifndef VMPROFILE_H
+#define VMPROFILE_H
+
+#include "stats.h"
+
+class VMScriptFunction;
+
+//==========================================================================
+//
+// Per-function profiling data, only allocated for functions that have
+// been run while the profiler was active.
+//
+//==========================================================================
+
+struct VMProfileInfo
+{
+	VMScriptFunction *Func;
+	unsigned long long NumCalls;
+	unsigned long long NumInstr;
+	cycle_t Inclusive;		// time spent in the function and everything it called
+	cycle_t Exclusive;		// time spent in the function alone
+
+	void Reset()
+	{
+		NumCalls = 0;
+		NumInstr = 0;
+		Inclusive.Reset();
+		Exclusive.Reset();
+	}
+};
+
+VMProfileInfo *VMProfileAlloc(VMScriptFunction *func);
+void VMProfileRelease(VMScriptFunction *func);
+bool VMProfiling();
+
+//==========================================================================
+//
+// VMProfileScope
+//
+// Lives on the stack of the profiling interpreter for the duration of one
+// call. While a callee runs, the caller's exclusive clock is stopped.
+//
+//==========================================================================
+
+struct VMProfileScope
+{
+	VMProfileInfo *Info;
+	VMProfileScope *Parent;
+	unsigned long long Instr;
+
+	static VMProfileScope *Current;
+
+	VMProfileScope(VMScriptFunction *func)
+	{
+		Info = func != nullptr ? VMProfileAlloc(func) : nullptr;
+		Parent = Current;
+		Instr = 0;
+		Current = this;
+		if (Parent != nullptr && Parent->Info != nullptr)
+		{
+			Parent->Info->Exclusive.Unclock();
+		}
+		if (Info != nullptr)
+		{
+			Info->NumCalls++;
+			Info->Inclusive.Clock();
+			Info->Exclusive.Clock();
+		}
+	}
+
+	~VMProfileScope()
+	{
+		if (Info != nullptr)
+		{
+			Info->Exclusive.Unclock();
+			Info->Inclusive.Unclock();
+			Info->NumInstr += Instr;
+		}
+		if (Parent != nullptr && Parent->Info != nullptr)
+		{
+			Parent->Info->Exclusive.Clock();
+		}
+		Current = Parent;
+	}
+};
+
+#endif
@@ -2366,6 +2366,7 @@ void ZCCCompiler::CompileFunction(ZCC_StructWork *c, ZCC_FuncDeclarator *f, bool
 							Error(f, "Attempt to override final function %s", FName(f->Name).GetChars());
 						}
 						clstype->Virtuals[vindex] = sym->Variants[0].Implementation;
+						PClass::VirtualGeneration++;
 						sym->Variants[0].Implementation->VirtualIndex = vindex;
 					}
 				}
@@ -2376,6 +2377,7 @@ void ZCCCompiler::CompileFunction(ZCC_StructWork *c, ZCC_FuncDeclarator *f, bool
 						Error(f, "Function %s attempts to override parent function without 'override' qualifier", FName(f->Name).GetChars());
 					}
 					sym->Variants[0].Implementation->VirtualIndex = clstype->Virtuals.Push(sym->Variants[0].Implementation);
+					PClass::VirtualGeneration++;
 				}
 			}
 			else
@@ -2408,6 +2410,7 @@ void ZCCCompiler::InitFunctions()
 		if (c->Type()->ParentClass != nullptr)
 		{
 			c->Type()->Virtuals = c->Type()->ParentClass->Virtuals;
+			PClass::VirtualGeneration++;
 		}
 		for (auto f : c->Functions)
 		{
@@ -43,6 +43,7 @@
 #include "v_text.h"
 #include "zcc_parser.h"
 #include "zcc_compile.h"
+#include "vmbuilder.h"
 
 TArray<FString> Includes;
 TArray<FScriptPosition> IncludeLocs;
@@ -245,6 +246,7 @@ static void ParseSingleFile(const char *filename, int lump, void *parser, ZCCPar
 	}
 	else sc.OpenLumpNum(lump);
 
+	FunctionBuildList.AddSourceLump(lump);
 	state.sc = &sc;
 	while (sc.GetToken())
 	{
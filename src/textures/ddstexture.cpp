@@ -484,6 +484,14 @@ const BYTE *FDDSTexture::GetPixels ()
 
 void FDDSTexture::MakeTexture ()
 {
+	BYTE cachekey[16];
+	bool cacheable = GetCacheKey(cachekey);
+
+	if (cacheable && (Pixels = ReadCachedPixels(cachekey, Width*Height)) != NULL)
+	{
+		return;
+	}
+
 	FWadLump lump = Wads.OpenLumpNum (SourceLump);
 
 	Pixels = new BYTE[Width*Height];
@@ -506,6 +514,10 @@ void FDDSTexture::MakeTexture ()
 	{
 		DecompressDXT5 (lump, Format == ID_DXT4);
 	}
+	if (cacheable)
+	{
+		WriteCachedPixels(cachekey, Pixels, Width*Height);
+	}
 }
 
 //==========================================================================
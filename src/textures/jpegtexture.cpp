@@ -366,6 +366,14 @@ const BYTE *FJPEGTexture::GetPixels ()
 
 void FJPEGTexture::MakeTexture ()
 {
+	BYTE cachekey[16];
+	bool cacheable = GetCacheKey(cachekey);
+
+	if (cacheable && (Pixels = ReadCachedPixels(cachekey, Width * Height)) != NULL)
+	{
+		return;
+	}
+
 	FWadLump lump = Wads.OpenLumpNum (SourceLump);
 	JSAMPLE *buff = NULL;
 
@@ -445,6 +453,10 @@ void FJPEGTexture::MakeTexture ()
 		}
 		jpeg_finish_decompress(&cinfo);
 		jpeg_destroy_decompress(&cinfo);
+		if (cacheable)
+		{
+			WriteCachedPixels(cachekey, Pixels, Width * Height);
+		}
 	}
 	catch (int)
 	{
@@ -52,6 +52,8 @@
 #include "m_fixed.h"
 #include "textures/textures.h"
 #include "r_data/colormaps.h"
+#include "md5.h"
+#include "m_swap.h"
 
 // On the Alpha, accessing the shorts directly if they aren't aligned on a
 // 4-byte boundary causes unaligned access warnings. Why it does this at
@@ -167,6 +169,7 @@ public:
 	FTexture *GetRedirect(bool wantwarped);
 	FTexture *GetRawTexture();
 	void ResolvePatches();
+	bool AddToCacheKey(MD5Context &md5);
 
 protected:
 	BYTE *Pixels;
@@ -487,6 +490,13 @@ void FMultiPatchTexture::MakeTexture ()
 	int numpix = Width * Height + (1 << HeightBits) - Height;
 	BYTE blendwork[256];
 	bool hasTranslucent = false;
+	BYTE cachekey[16];
+	bool cacheable = GetCacheKey(cachekey);
+
+	if (cacheable && (Pixels = ReadCachedPixels(cachekey, numpix)) != NULL)
+	{
+		return;
+	}
 
 	Pixels = new BYTE[numpix];
 	memset (Pixels, 0, numpix);
@@ -539,6 +549,42 @@ void FMultiPatchTexture::MakeTexture ()
 		}
 		delete [] buffer;
 	}
+	if (cacheable)
+	{
+		WriteCachedPixels(cachekey, Pixels, numpix);
+	}
+}
+
+//==========================================================================
+//
+// FMultiPatchTexture :: AddToCacheKey
+//
+// The composited texture depends on the layout and on every patch's data.
+//
+//==========================================================================
+
+bool FMultiPatchTexture::AddToCacheKey(MD5Context &md5)
+{
+	BYTE props[7] = { BYTE(Width), BYTE(Width >> 8), BYTE(Height), BYTE(Height >> 8), BYTE(NumParts), BYTE(NumParts >> 8), bNoRemap0 };
+	md5.Update(props, sizeof(props));
+
+	for (int i = 0; i < NumParts; ++i)
+	{
+		if (Parts[i].Texture->bHasCanvas) continue;	// not drawn by MakeTexture
+
+		SDWORD part[6] = { LittleLong(Parts[i].OriginX), LittleLong(Parts[i].OriginY), LittleLong(Parts[i].Rotate),
+			LittleLong(Parts[i].op), LittleLong(SDWORD(Parts[i].Blend)), LittleLong(Parts[i].Alpha) };
+		md5.Update((const BYTE *)part, sizeof(part));
+		if (Parts[i].Translation != NULL)
+		{
+			md5.Update(Parts[i].Translation->Remap, 256);
+		}
+		if (!Parts[i].Texture->AddToCacheKey(md5))
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
 //===========================================================================
@@ -459,6 +459,13 @@ const BYTE *FPNGTexture::GetPixels ()
 void FPNGTexture::MakeTexture ()
 {
 	FileReader *lump;
+	BYTE cachekey[16];
+	bool cacheable = GetCacheKey(cachekey);
+
+	if (cacheable && (Pixels = ReadCachedPixels(cachekey, Width*Height)) != NULL)
+	{
+		return;
+	}
 
 	if (SourceLump >= 0)
 	{
@@ -602,6 +609,10 @@ void FPNGTexture::MakeTexture ()
 			}
 			delete[] tempix;
 		}
+		if (cacheable)
+		{
+			WriteCachedPixels(cachekey, Pixels, Width*Height);
+		}
 	}
 	if (lump != fr) delete lump;
 }
@@ -46,6 +46,17 @@
 #include "m_fixed.h"
 #include "textures/textures.h"
 #include "v_palette.h"
+#include "md5.h"
+#include "m_misc.h"
+#include "cmdlib.h"
+#include "m_swap.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Keep the 8-bit result of expensive texture conversions in the user's cache directory.
+CVAR(Bool, r_texturediskcache, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CVAR(Int, r_texturediskcachesize, 64, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)	// in megabytes
 
 typedef bool (*CheckFunc)(FileReader & file);
 typedef FTexture * (*CreateFunc)(FileReader & file, int lumpnum);
@@ -150,8 +161,8 @@ FTexture::FTexture (const char *name, int lumpnum)
 : LeftOffset(0), TopOffset(0),
   WidthBits(0), HeightBits(0), Scale(1,1), SourceLump(lumpnum),
   UseType(TEX_Any), bNoDecals(false), bNoRemap0(false), bWorldPanning(false),
-  bMasked(true), bAlphaTexture(false), bHasCanvas(false), bWarped(0), bComplex(false), bMultiPatch(false), bKeepAround(false),
-  Rotations(0xFFFF), SkyOffset(0), Width(0), Height(0), WidthMask(0), Native(NULL)
+  bMasked(true), bAlphaTexture(false), bHasCanvas(false), bWarped(0), bComplex(false), bMultiPatch(false), bKeepAround(false), bResident(false),
+  LastUseFrame(-1), ResidentSize(0), Rotations(0xFFFF), SkyOffset(0), Width(0), Height(0), WidthMask(0), Native(NULL)
 {
 	id.SetInvalid();
 	if (name != NULL)
@@ -173,6 +184,7 @@ FTexture::~FTexture ()
 {
 	FTexture *link = Wads.GetLinkedTexture(SourceLump);
 	if (link == this) Wads.SetLinkedTexture(SourceLump, NULL);
+	if (bResident) TexMan.RemoveResident(this);
 	KillNative();
 }
 
@@ -675,6 +687,287 @@ const BYTE *FDummyTexture::GetPixels ()
 	return NULL;
 }
 
+//==========================================================================
+//
+// Persistent texture cache
+//
+// Textures whose 8-bit pixels are expensive to produce (true color images
+// that need to be matched to the palette, and composited multipatch
+// textures) can store the result in the user's cache directory, next to
+// the cached GL nodes. The file name is an MD5 over the palette and the
+// identity of every source lump (file, name, size and modification time),
+// so the lump data itself is never read just to look up the cache.
+//
+// The directory is limited to r_texturediskcachesize megabytes. When a write
+// goes over that the oldest files are removed.
+//
+//==========================================================================
+
+static const char TextureCacheMagic[4] = { 'Z', 'T', 'C', '2' };
+
+enum
+{
+	TCF_Masked = 1,
+};
+
+static SQWORD TextureCacheBytes = -1;	// -1 means the directory hasn't been scanned yet
+
+static FString TextureCachePath(bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/textures";
+	if (create) CreatePath(path);
+	path << '/';
+	return path;
+}
+
+static FString TextureCacheName(const BYTE key[16], bool create)
+{
+	FString path = TextureCachePath(create);
+	for (int i = 0; i < 16; i++)
+	{
+		path.AppendFormat("%02x", key[i]);
+	}
+	path << ".ztc";
+	return path;
+}
+
+//==========================================================================
+//
+// TrimTextureCache
+//
+// Deletes the oldest cache files until the directory holds no more than
+// limit bytes and returns the remaining size.
+//
+//==========================================================================
+
+struct FTextureCacheFile
+{
+	FString Filename;
+	time_t Time;
+	SQWORD Size;
+};
+
+static int SortTextureCacheFiles(const void *a, const void *b)
+{
+	time_t ta = ((const FTextureCacheFile *)a)->Time;
+	time_t tb = ((const FTextureCacheFile *)b)->Time;
+	return ta < tb ? -1 : ta > tb ? 1 : 0;
+}
+
+static SQWORD TrimTextureCache(SQWORD limit)
+{
+	TArray<FFileList> list;
+	TArray<FTextureCacheFile> files;
+	SQWORD total = 0;
+
+	try
+	{
+		ScanDirectory(list, TextureCachePath(false));
+	}
+	catch (CRecoverableError &)
+	{
+		return 0;
+	}
+
+	for (unsigned i = 0; i < list.Size(); i++)
+	{
+		struct stat info;
+		if (!list[i].isDirectory && stat(list[i].Filename, &info) == 0)
+		{
+			FTextureCacheFile file = { list[i].Filename, info.st_mtime, (SQWORD)info.st_size };
+			files.Push(file);
+			total += file.Size;
+		}
+	}
+	if (total > limit && files.Size() > 0)
+	{
+		qsort(&files[0], files.Size(), sizeof(files[0]), SortTextureCacheFiles);
+		for (unsigned i = 0; i < files.Size() && total > limit; i++)
+		{
+			if (remove(files[i].Filename) == 0)
+			{
+				total -= files[i].Size;
+			}
+		}
+	}
+	return total;
+}
+
+//==========================================================================
+//
+// AddLumpToCacheKey
+//
+// Identifies a lump without reading it. Lumps whose container can't be
+// found on disk (e.g. inside a nested WAD) fall back to hashing the data.
+//
+//==========================================================================
+
+static void AddLumpToCacheKey(MD5Context &md5, int lumpnum)
+{
+	const char *container = Wads.GetWadFullName(Wads.GetLumpFile(lumpnum));
+	const char *lumpname = Wads.GetLumpFullName(lumpnum);
+	struct stat info;
+
+	if (container == NULL || stat(container, &info) != 0)
+	{
+		FWadLump lump = Wads.OpenLumpNum(lumpnum);
+		md5.Update(&lump, lump.GetLength());
+		return;
+	}
+	if (info.st_mode & S_IFDIR)
+	{
+		// A lump in a directory is a file of its own.
+		FString path = container;
+		if (path.Len() > 0 && path[path.Len() - 1] != '/') path << '/';
+		path << lumpname;
+		if (stat(path, &info) != 0) info.st_mtime = 0;
+	}
+
+	// The cache is local to this machine, so byte order doesn't matter here.
+	SQWORD ident[4] = { lumpnum, Wads.LumpLength(lumpnum), (SQWORD)info.st_mtime, (SQWORD)info.st_size };
+	md5.Update((const BYTE *)ident, sizeof(ident));
+	md5.Update((const BYTE *)container, (unsigned)strlen(container) + 1);
+	md5.Update((const BYTE *)lumpname, (unsigned)strlen(lumpname) + 1);
+}
+
+//==========================================================================
+//
+// FTexture :: AddToCacheKey
+//
+// Adds everything this texture's pixels depend on. The default handles
+// textures that are converted from a single lump. Returns false if the
+// texture cannot be cached.
+//
+//==========================================================================
+
+bool FTexture::AddToCacheKey(MD5Context &md5)
+{
+	if (SourceLump < 0 || bHasCanvas || bWarped)
+	{
+		return false;
+	}
+	BYTE props[7] = { BYTE(Width), BYTE(Width >> 8), BYTE(Height), BYTE(Height >> 8),
+		UseType, bAlphaTexture, bNoRemap0 };
+	md5.Update(props, sizeof(props));
+	AddLumpToCacheKey(md5, SourceLump);
+	return true;
+}
+
+//==========================================================================
+//
+// FTexture :: GetCacheKey
+//
+//==========================================================================
+
+bool FTexture::GetCacheKey(BYTE key[16])
+{
+	if (!r_texturediskcache)
+	{
+		return false;
+	}
+	MD5Context md5;
+	md5.Update((const BYTE *)TextureCacheMagic, sizeof(TextureCacheMagic));
+	md5.Update((const BYTE *)GPalette.BaseColors, sizeof(GPalette.BaseColors));
+	if (!AddToCacheKey(md5))
+	{
+		return false;
+	}
+	md5.Final(key);
+	return true;
+}
+
+//==========================================================================
+//
+// FTexture :: ReadCachedPixels
+//
+// Returns a new[]'d buffer of size bytes, or NULL if there is no valid
+// cache file for this key. Flags that the conversion would have set are
+// restored from the file.
+//
+//==========================================================================
+
+BYTE *FTexture::ReadCachedPixels(const BYTE key[16], unsigned size)
+{
+	FString path = TextureCacheName(key, false);
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) return NULL;
+
+	char magic[4];
+	BYTE filekey[16];
+	DWORD filesize;
+	BYTE flags;
+	BYTE *pixels = NULL;
+
+	if (fread(magic, 1, 4, f) == 4 && !memcmp(magic, TextureCacheMagic, 4) &&
+		fread(filekey, 1, 16, f) == 16 && !memcmp(filekey, key, 16) &&
+		fread(&filesize, 4, 1, f) == 1 && LittleLong(filesize) == size &&
+		fread(&flags, 1, 1, f) == 1)
+	{
+		pixels = new BYTE[size];
+		if (fread(pixels, 1, size, f) != size)
+		{
+			delete[] pixels;
+			pixels = NULL;
+		}
+		else
+		{
+			bMasked = !!(flags & TCF_Masked);
+		}
+	}
+	fclose(f);
+	return pixels;
+}
+
+//==========================================================================
+//
+// FTexture :: WriteCachedPixels
+//
+//==========================================================================
+
+void FTexture::WriteCachedPixels(const BYTE key[16], const BYTE *pixels, unsigned size)
+{
+	SQWORD limit = (SQWORD)MAX<int>(r_texturediskcachesize, 0) << 20;
+	unsigned filelen = 4 + 16 + 4 + 1 + size;
+
+	if (filelen > limit)
+	{
+		return;
+	}
+	if (TextureCacheBytes < 0)
+	{
+		TextureCacheBytes = TrimTextureCache(limit);
+	}
+	if (TextureCacheBytes + filelen > limit)
+	{
+		// Make room for this and some more, so that a full cache doesn't
+		// have to be scanned for every texture.
+		TextureCacheBytes = TrimTextureCache(limit - MAX<SQWORD>(filelen, limit / 4));
+	}
+
+	FString path = TextureCacheName(key, true);
+	FILE *f = fopen(path, "wb");
+
+	if (f != NULL)
+	{
+		DWORD filesize = LittleLong(size);
+		BYTE flags = bMasked ? TCF_Masked : 0;
+		if (fwrite(TextureCacheMagic, 1, 4, f) != 4 ||
+			fwrite(key, 1, 16, f) != 16 ||
+			fwrite(&filesize, 4, 1, f) != 1 ||
+			fwrite(&flags, 1, 1, f) != 1 ||
+			fwrite(pixels, 1, size, f) != size)
+		{
+			fclose(f);
+			remove(path);
+			Printf("Error saving texture %s to cache file %s\n", Name.GetChars(), path.GetChars());
+			return;
+		}
+		fclose(f);
+		TextureCacheBytes += filelen;
+	}
+}
+
 //==========================================================================
 //
 // Debug stuff
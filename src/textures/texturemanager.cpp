@@ -34,6 +34,8 @@
 **
 */
 
+#include <algorithm>
+
 #include "doomtype.h"
 #include "doomstat.h"
 #include "w_wad.h"
@@ -53,9 +55,13 @@
 #include "r_renderer.h"
 #include "r_sky.h"
 #include "textures/textures.h"
+#include "stats.h"
 
 FTextureManager TexMan;
 
+// Memory budget in megabytes for cached software renderer textures. 0 means no limit.
+CVAR(Int, r_texturecachesize, 0, CVAR_ARCHIVE)
+
 CUSTOM_CVAR(Bool, vid_nopalsubstitutions, false, CVAR_ARCHIVE)
 {
 	// This is in case the sky texture has been substituted.
@@ -71,6 +77,9 @@ CUSTOM_CVAR(Bool, vid_nopalsubstitutions, false, CVAR_ARCHIVE)
 FTextureManager::FTextureManager ()
 {
 	memset (HashFirst, -1, sizeof(HashFirst));
+	ResidentBytes = 0;
+	ResidentFrame = 0;
+	ResidentHits = ResidentMisses = ResidentEvictions = 0;
 
 	for (int i = 0; i < 2048; ++i)
 	{
@@ -97,6 +106,7 @@ FTextureManager::~FTextureManager ()
 
 void FTextureManager::DeleteAll()
 {
+	ClearResident();
 	for (unsigned int i = 0; i < Textures.Size(); ++i)
 	{
 		delete Textures[i].Texture;
@@ -362,6 +372,135 @@ void FTextureManager::UnloadAll ()
 	{
 		Textures[i].Texture->Unload ();
 	}
+	ClearResident();
+}
+
+//==========================================================================
+//
+// FTextureManager :: AddResident
+//
+// Called the first time a texture is drawn in a frame.
+//
+//==========================================================================
+
+void FTextureManager::AddResident(FTexture *tex)
+{
+	if (tex->bResident)
+	{
+		ResidentHits++;
+		return;
+	}
+	ResidentMisses++;
+
+	// Textures that are referenced by other textures or render targets can't be evicted.
+	if (tex->bKeepAround || tex->bHasCanvas)
+	{
+		return;
+	}
+	int width = tex->GetWidth();
+	tex->ResidentSize = width * tex->GetHeight() + width * (sizeof(FTexture::Span *) + 2 * sizeof(FTexture::Span));
+	tex->bResident = true;
+	ResidentBytes += tex->ResidentSize;
+	ResidentTextures.Push(tex);
+}
+
+//==========================================================================
+//
+// FTextureManager :: RemoveResident
+//
+// Stops tracking a texture, e.g. because it is being deleted or unloaded.
+//
+//==========================================================================
+
+void FTextureManager::RemoveResident(FTexture *tex)
+{
+	if (tex->bResident)
+	{
+		for (unsigned i = 0; i < ResidentTextures.Size(); i++)
+		{
+			if (ResidentTextures[i] == tex)
+			{
+				ResidentTextures.Delete(i);
+				break;
+			}
+		}
+		ResidentBytes -= tex->ResidentSize;
+		tex->bResident = false;
+	}
+}
+
+//==========================================================================
+//
+// FTextureManager :: ClearResident
+//
+//==========================================================================
+
+void FTextureManager::ClearResident()
+{
+	for (unsigned i = 0; i < ResidentTextures.Size(); i++)
+	{
+		ResidentTextures[i]->bResident = false;
+	}
+	ResidentTextures.Clear();
+	ResidentBytes = 0;
+}
+
+//==========================================================================
+//
+// FTextureManager :: TrimResident
+//
+// Must only be called once the drawers have finished the current frame,
+// because queued drawer commands point directly into texture data.
+// Textures used in the frame that just finished are never evicted.
+//
+//==========================================================================
+
+void FTextureManager::TrimResident()
+{
+	size_t budget = size_t(MAX<int>(r_texturecachesize, 0)) << 20;
+
+	if (budget > 0 && ResidentBytes > budget)
+	{
+		std::sort(&ResidentTextures[0], &ResidentTextures[0] + ResidentTextures.Size(),
+			[](FTexture *a, FTexture *b) { return a->LastUseFrame < b->LastUseFrame; });
+
+		unsigned i;
+		for (i = 0; i < ResidentTextures.Size() && ResidentBytes > budget; i++)
+		{
+			FTexture *tex = ResidentTextures[i];
+			if (tex->LastUseFrame == ResidentFrame)
+			{
+				break;
+			}
+			tex->Unload();
+			tex->bResident = false;
+			ResidentBytes -= tex->ResidentSize;
+			ResidentEvictions++;
+		}
+		ResidentTextures.Delete(0, i);
+	}
+	ResidentFrame++;
+}
+
+//==========================================================================
+//
+// FTextureManager :: GetResidentStats
+//
+//==========================================================================
+
+FString FTextureManager::GetResidentStats()
+{
+	FString out;
+	unsigned total = ResidentHits + ResidentMisses;
+	out.Format("Resident textures: %u (%.1f MB, limit %d MB)  Hits: %u  Misses: %u (%.1f%% hit)  Evicted: %u",
+		ResidentTextures.Size(), ResidentBytes / 1048576., *r_texturecachesize,
+		ResidentHits, ResidentMisses, total == 0 ? 0. : ResidentHits * 100. / total, ResidentEvictions);
+	return out;
+}
+
+ADD_STAT(texcache)
+{
+	return TexMan.GetResidentStats();
 }
 
 //==========================================================================
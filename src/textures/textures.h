@@ -107,6 +107,7 @@ enum FTextureFormat
 };
 
 class FNativeTexture;
+struct MD5Context;
 
 // Base texture class
 class FTexture
@@ -140,6 +141,10 @@ public:
 							// doing it per patch.
 	BYTE bMultiPatch:1;		// This is a multipatch texture (we really could use real type info for textures...)
 	BYTE bKeepAround:1;		// This texture was used as part of a multi-patch texture. Do not free it.
+	BYTE bResident:1;		// This texture is in the texture manager's resident list.
+
+	int LastUseFrame;		// Last frame the software renderer drew with this texture
+	unsigned ResidentSize;	// Estimated size of the cached pixels and spans when it became resident
 
 	WORD Rotations;
 	SWORD SkyOffset;
@@ -244,6 +249,9 @@ public:
 
 	virtual void HackHack (int newheight);	// called by FMultipatchTexture to discover corrupt patches.
 
+	// Adds everything this texture's pixels depend on to a persistent cache key.
+	virtual bool AddToCacheKey(MD5Context &md5);
+
 protected:
 	WORD Width, Height, WidthMask;
 	static BYTE GrayMap[256];
@@ -251,6 +259,10 @@ protected:
 
 	FTexture (const char *name = NULL, int lumpnum = -1);
 
+	bool GetCacheKey(BYTE key[16]);
+	BYTE *ReadCachedPixels(const BYTE key[16], unsigned size);
+	void WriteCachedPixels(const BYTE key[16], const BYTE *pixels, unsigned size);
+
 	Span **CreateSpans (const BYTE *pixels) const;
 	void FreeSpans (Span **spans) const;
 	void CalcBitSize ();
@@ -382,6 +394,22 @@ public:
 
 	void UnloadAll ();
 
+	// Residency tracking for the software renderer. Textures the renderer
+	// draws with are kept in a list, and once their estimated cache size
+	// exceeds r_texturecachesize, the least recently used ones are unloaded
+	// at the end of a frame.
+	void MarkUsed(FTexture *tex)
+	{
+		if (tex->LastUseFrame != ResidentFrame)
+		{
+			tex->LastUseFrame = ResidentFrame;
+			AddResident(tex);
+		}
+	}
+	void RemoveResident(FTexture *tex);
+	void TrimResident();
+	FString GetResidentStats();
+
 	int NumTextures () const { return (int)Textures.Size(); }
 
 	void UpdateAnimations (DWORD mstime);
@@ -422,6 +450,9 @@ private:
 
 	void InitPalettedVersions();
 
+	void AddResident(FTexture *tex);
+	void ClearResident();
+
 	// Switches
 
 	void InitSwitchList ();
@@ -446,6 +477,11 @@ private:
 	TArray<FSwitchDef *> mSwitchDefs;
 	TArray<FDoorAnimation> mAnimatedDoors;
 	TArray<BYTE *> BuildTileFiles;
+
+	TArray<FTexture *> ResidentTextures;
+	size_t ResidentBytes;
+	int ResidentFrame;
+	unsigned ResidentHits, ResidentMisses, ResidentEvictions;
 public:
 	short sintable[2048];	// for texture warping
 	enum
@@ -288,6 +288,14 @@ void FTGATexture::ReadCompressed(FileReader &lump, BYTE * buffer, int bytesperpi
 
 void FTGATexture::MakeTexture ()
 {
+	BYTE cachekey[16];
+	bool cacheable = GetCacheKey(cachekey);
+
+	if (cacheable && (Pixels = ReadCachedPixels(cachekey, Width*Height)) != NULL)
+	{
+		return;
+	}
+
 	BYTE PaletteMap[256];
 	FWadLump lump = Wads.OpenLumpNum (SourceLump);
 	TGAHeader hdr;
@@ -479,6 +487,10 @@ void FTGATexture::MakeTexture ()
 		break;
     }
 	delete [] buffer;
+	if (cacheable)
+	{
+		WriteCachedPixels(cachekey, Pixels, Width*Height);
+	}
 }	
 
 //===========================================================================
@@ -7,14 +7,64 @@ inline unsigned GetVirtualIndex(PClass *cls, const char *funcname)
 	return VIndex;
 }
 
-#define IFVIRTUALPTR(self, cls, funcname) \
+//==========================================================================
+//
+// FVirtualCache
+//
+// Remembers what a call site's virtual function resolved to for the last
+// few classes it was called for. Most sites only ever see one or two
+// classes at a time, which then only costs a pointer compare. Everything
+// is forgotten when PClass::VirtualGeneration changes.
+//
+// With scriptonly set, native implementations resolve to nullptr so that
+// the caller can call the native function directly instead of going
+// through the VM.
+//
+//==========================================================================
+
+struct FVirtualCache
+{
+	enum { NUM_ENTRIES = 4 };
+
+	PClass *Class[NUM_ENTRIES];
+	VMFunction *Func[NUM_ENTRIES];
+	unsigned Generation;
+	unsigned Next;
+
+	VMFunction *Find(PClass *cls, unsigned vindex, bool scriptonly)
+	{
+		if (Generation != PClass::VirtualGeneration)
+		{
+			for (int i = 0; i < NUM_ENTRIES; i++) Class[i] = nullptr;
+			Generation = PClass::VirtualGeneration;
+		}
+		for (int i = 0; i < NUM_ENTRIES; i++)
+		{
+			if (Class[i] == cls) return Func[i];
+		}
+		VMFunction *func = cls->Virtuals.Size() > vindex ? cls->Virtuals[vindex] : nullptr;
+		if (scriptonly && func != nullptr && func->Native) func = nullptr;
+		Class[Next] = cls;
+		Func[Next] = func;
+		Next = (Next + 1) % NUM_ENTRIES;
+		return func;
+	}
+};
+
+#define IFVIRTUALCACHED(self, cls, funcname, scriptonly) \
 	static unsigned VIndex = ~0u; \
+	static FVirtualCache VCache; \
 	if (VIndex == ~0u) { \
 		VIndex = GetVirtualIndex(RUNTIME_CLASS(cls), #funcname); \
 		assert(VIndex != ~0u); \
 	} \
 	auto clss = self->GetClass(); \
-	VMFunction *func = clss->Virtuals.Size() > VIndex? clss->Virtuals[VIndex] : nullptr;  \
+	VMFunction *func = VCache.Find(clss, VIndex, scriptonly);  \
 	if (func != nullptr)
 
+#define IFVIRTUALPTR(self, cls, funcname) IFVIRTUALCACHED(self, cls, funcname, false)
 #define IFVIRTUAL(cls, funcname) IFVIRTUALPTR(this, cls, funcname)
+
+// Only taken if a script overrides the function. The native version must be called otherwise.
+#define IFOVERRIDENVIRTUALPTR(self, cls, funcname) IFVIRTUALCACHED(self, cls, funcname, true)
+#define IFOVERRIDENVIRTUAL(cls, funcname) IFOVERRIDENVIRTUALPTR(this, cls, funcname)